@@ -0,0 +1,424 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Rubiks2x2DistanceTable.h"
+#include "TheCubePlayGround.h"
+#include "Async/ParallelFor.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/PlatformFilemanager.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+#define DISTANCE_TABLE_MAGIC 0x52324454 //"R2DT"
+#define DISTANCE_TABLE_VERSION 1
+#define DISTANCE_TABLE_HEADER_SIZE 16
+#define DISTANCE_TABLE_UNVISITED 0xF
+#define DISTANCE_TABLE_CHUNK_SIZE 65536
+
+namespace
+{
+	//Doubled coordinates of the corner a 2x2x2 cell sits in (cells are x + 2y + 4z)
+	FIntVector GetCorner(int32 cell)
+	{
+		return FIntVector((cell & 1) ? 1 : -1, (cell & 2) ? 1 : -1, (cell & 4) ? 1 : -1);
+	}
+
+	int32 GetCornerCell(const FIntVector& corner)
+	{
+		return (corner.X > 0 ? 1 : 0) + (corner.Y > 0 ? 2 : 0) + (corner.Z > 0 ? 4 : 0);
+	}
+
+	//Which of the three orientations a corner piece has in its cell: where its top/bottom facing side now points.
+	//The direction of the count flips with the parity of the cell so the twists of a reachable state always add up to 0 mod 3.
+	int32 GetTwist(int32 homeCell, int32 cell, uint8 orientation)
+	{
+		FIntVector side = FRubiksCubeState::RotateAxisVector(orientation, FIntVector(0, 0, (homeCell & 4) ? 1 : -1));
+		if (side.Z != 0) {
+			return 0;
+		}
+
+		bool oddCell = (((cell & 1) + ((cell >> 1) & 1) + ((cell >> 2) & 1)) & 1) != 0;
+		return ((side.X != 0) != oddCell) ? 1 : 2;
+	}
+
+	struct FCoordinateTables
+	{
+		int32 HomeCells[8];
+		int32 HomePieces[8];
+		uint8 Orientations[8][8][3];
+		int32 Factorials[8];
+		int32 PowersOf3[7];
+		uint16 PermutationMoves[5040][FRubiks2x2DistanceTable::NumMoves];
+		uint16 TwistMoves[729][FRubiks2x2DistanceTable::NumMoves];
+
+		FCoordinateTables()
+		{
+			const FRubiksCubeLayout& layout = FRubiksCubeLayout::Get(2);
+			for (int32 x = 0; x < 8; x++) {
+				HomeCells[x] = layout.HomeCells[x];
+				HomePieces[x] = layout.HomePieces[x];
+			}
+
+			Factorials[0] = 1;
+			for (int32 x = 1; x < 8; x++) {
+				Factorials[x] = Factorials[x - 1] * x;
+			}
+			PowersOf3[0] = 1;
+			for (int32 x = 1; x < 7; x++) {
+				PowersOf3[x] = PowersOf3[x - 1] * 3;
+			}
+
+			//Orientation that takes a piece from its home cell to a cell with a given twist
+			FMemory::Memset(Orientations, 0xFF, sizeof(Orientations));
+			for (int32 home = 0; home < 8; home++) {
+				for (int32 cell = 0; cell < 8; cell++) {
+					for (uint8 o = 0; o < 24; o++) {
+						if (FRubiksCubeState::RotateAxisVector(o, GetCorner(home)) == GetCorner(cell)) {
+							Orientations[home][cell][GetTwist(home, cell, o)] = o;
+						}
+					}
+				}
+			}
+
+			//Each layer turn keeps piece 1 home, so permutation and twist move independently of each other
+			FRubiksCubeState state;
+			for (int32 m = 0; m < FRubiks2x2DistanceTable::NumMoves; m++) {
+				FRubiksMove move = FRubiks2x2DistanceTable::GetMove(m);
+				for (int32 p = 0; p < 5040; p++) {
+					Unrank(p * 729, state);
+					state.ApplyMove(move);
+					PermutationMoves[p][m] = (uint16)(Rank(state) / 729);
+				}
+				for (int32 t = 0; t < 729; t++) {
+					Unrank(t, state);
+					state.ApplyMove(move);
+					TwistMoves[t][m] = (uint16)(Rank(state) % 729);
+				}
+			}
+		}
+
+		int32 Rank(const FRubiksCubeState& state) const
+		{
+			//Turn the whole cube so piece 1 is home with no rotation
+			uint8 normalize = FRubiksCubeState::InvertOrientation(state.GetPieceOrientation(0));
+
+			//Pieces are told apart by their home cell, so the solved cube ranks as 0
+			int32 cellHomes[8];
+			uint8 cellOrientations[8];
+			for (int32 piece = 0; piece < 8; piece++) {
+				FIntVector corner = FRubiksCubeState::RotateAxisVector(normalize, GetCorner(state.GetPieceCell(piece)));
+				int32 cell = GetCornerCell(corner);
+				cellHomes[cell] = HomeCells[piece];
+				cellOrientations[cell] = FRubiksCubeState::ComposeOrientations(normalize, state.GetPieceOrientation(piece));
+			}
+
+			//Lehmer code of the home cells of the pieces in cells 1..7
+			int32 permutation = 0;
+			for (int32 i = 1; i < 8; i++) {
+				int32 smaller = 0;
+				for (int32 j = i + 1; j < 8; j++) {
+					if (cellHomes[j] < cellHomes[i]) {
+						smaller++;
+					}
+				}
+				permutation += smaller * Factorials[7 - i];
+			}
+
+			//The twist of cell 7 follows from the others
+			int32 twist = 0;
+			for (int32 cell = 1; cell < 7; cell++) {
+				twist += GetTwist(cellHomes[cell], cell, cellOrientations[cell]) * PowersOf3[cell - 1];
+			}
+
+			return permutation * 729 + twist;
+		}
+
+		void Unrank(int32 index, FRubiksCubeState& outState) const
+		{
+			if (outState.GetSize() != 2) {
+				outState.Reset(2);
+			}
+
+			int32 permutation = index / 729;
+			int32 twist = index % 729;
+
+			int32 cellHomes[8];
+			bool used[8] = { true, false, false, false, false, false, false, false };
+			cellHomes[0] = 0;
+			for (int32 i = 1; i < 8; i++) {
+				int32 smaller = permutation / Factorials[7 - i];
+				permutation %= Factorials[7 - i];
+				for (int32 home = 1; home < 8; home++) {
+					if (!used[home] && smaller-- == 0) {
+						cellHomes[i] = home;
+						used[home] = true;
+						break;
+					}
+				}
+			}
+
+			int32 cellTwists[8];
+			int32 twistSum = 0;
+			cellTwists[0] = 0;
+			for (int32 cell = 1; cell < 7; cell++) {
+				cellTwists[cell] = twist % 3;
+				twist /= 3;
+				twistSum += cellTwists[cell];
+			}
+			cellTwists[7] = (3 - twistSum % 3) % 3;
+
+			for (int32 cell = 0; cell < 8; cell++) {
+				outState.SetPiece(HomePieces[cellHomes[cell]], cell, Orientations[cellHomes[cell]][cell][cellTwists[cell]]);
+			}
+		}
+	};
+
+	const FCoordinateTables& GetCoordinateTables()
+	{
+		static const FCoordinateTables* Tables = new FCoordinateTables();
+		return *Tables;
+	}
+}
+
+
+FRubiks2x2DistanceTable::FRubiks2x2DistanceTable()
+	: Data(NULL), MappedFile(NULL), MappedRegion(NULL)
+{
+}
+
+FRubiks2x2DistanceTable::~FRubiks2x2DistanceTable()
+{
+	Unload();
+}
+
+FRubiks2x2DistanceTable& FRubiks2x2DistanceTable::Get()
+{
+	static FRubiks2x2DistanceTable* Table = []()
+	{
+		//Generating takes seconds of every core, so it is never done in game
+		FRubiks2x2DistanceTable* table = new FRubiks2x2DistanceTable();
+		if (!table->LoadFromFile(GetDefaultFilename())) {
+			UE_LOG(LogTemp, Warning, TEXT("No 2x2x2 distance table at %s, run the RubiksDistanceTable commandlet to generate it"), *GetDefaultFilename());
+		}
+		return table;
+	}();
+
+	return *Table;
+}
+
+void FRubiks2x2DistanceTable::Generate()
+{
+	double startTime = FPlatformTime::Seconds();
+
+	const FCoordinateTables& tables = GetCoordinateTables();
+
+	Unload();
+	OwnedWords.Init(0xFFFFFFFF, (NumStates + 7) / 8);
+	Data = OwnedWords.GetData();
+
+	//Solved is index 0
+	OwnedWords[0] &= ~(uint32)DISTANCE_TABLE_UNVISITED;
+
+	int32 numChunks = (NumStates + DISTANCE_TABLE_CHUNK_SIZE - 1) / DISTANCE_TABLE_CHUNK_SIZE;
+	volatile int32* words = (volatile int32*)OwnedWords.GetData();
+
+	for (int32 depth = 0; depth < DISTANCE_TABLE_UNVISITED - 1; depth++) {
+		volatile int32 found = 0;
+
+		//Expand every state of this depth, claiming unvisited neighbours with a compare and swap on their word
+		ParallelFor(numChunks, [&](int32 chunk)
+		{
+			int32 chunkFound = 0;
+			int32 first = chunk * DISTANCE_TABLE_CHUNK_SIZE;
+			int32 last = FMath::Min(first + DISTANCE_TABLE_CHUNK_SIZE, (int32)NumStates);
+
+			for (int32 index = first; index < last; index++) {
+				if (GetNibble(index) != depth) {
+					continue;
+				}
+
+				int32 permutation = index / 729;
+				int32 twist = index % 729;
+				for (int32 m = 0; m < NumMoves; m++) {
+					int32 next = tables.PermutationMoves[permutation][m] * 729 + tables.TwistMoves[twist][m];
+					int32 shift = (next & 7) * 4;
+
+					while (true) {
+						uint32 oldWord = (uint32)words[next >> 3];
+						if (((oldWord >> shift) & DISTANCE_TABLE_UNVISITED) != DISTANCE_TABLE_UNVISITED) {
+							break;
+						}
+
+						uint32 newWord = (oldWord & ~((uint32)DISTANCE_TABLE_UNVISITED << shift)) | ((uint32)(depth + 1) << shift);
+						if (FPlatformAtomics::InterlockedCompareExchange(&words[next >> 3], (int32)newWord, (int32)oldWord) == (int32)oldWord) {
+							chunkFound++;
+							break;
+						}
+					}
+				}
+			}
+
+			FPlatformAtomics::InterlockedAdd(&found, chunkFound);
+		});
+
+		if (found == 0) {
+			break;
+		}
+	}
+
+	CountDepths();
+
+	UE_LOG(LogTemp, Log, TEXT("2x2x2 distance table generated in %.2fs, %d states up to %d moves"),
+		FPlatformTime::Seconds() - startTime, (int32)NumStates, DepthCounts.Num() - 1);
+}
+
+bool FRubiks2x2DistanceTable::SaveToFile(const FString& filename) const
+{
+	if (!Data) {
+		return false;
+	}
+
+	IFileManager::Get().MakeDirectory(*FPaths::GetPath(filename), true);
+
+	FArchive* writer = IFileManager::Get().CreateFileWriter(*filename);
+	if (!writer) {
+		UE_LOG(LogTemp, Warning, TEXT("Can't write distance table %s"), *filename);
+		return false;
+	}
+
+	uint32 magic = DISTANCE_TABLE_MAGIC;
+	uint32 version = DISTANCE_TABLE_VERSION;
+	uint32 numStates = NumStates;
+	uint32 reserved = 0;
+	*writer << magic << version << numStates << reserved;
+	writer->Serialize((void*)Data, ((NumStates + 7) / 8) * sizeof(uint32));
+
+	bool success = !writer->IsError();
+	delete writer;
+	return success;
+}
+
+bool FRubiks2x2DistanceTable::LoadFromFile(const FString& filename)
+{
+	Unload();
+
+	int64 expectedSize = DISTANCE_TABLE_HEADER_SIZE + ((NumStates + 7) / 8) * sizeof(uint32);
+
+	//The header is 4 little endian uint32: magic, version, number of states, reserved
+	auto IsValidHeader = [](const uint8* header)
+	{
+		const uint32* fields = (const uint32*)header;
+		return fields[0] == DISTANCE_TABLE_MAGIC && fields[1] == DISTANCE_TABLE_VERSION && fields[2] == NumStates;
+	};
+
+	MappedFile = FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*filename);
+	if (MappedFile && MappedFile->GetFileSize() == expectedSize) {
+		MappedRegion = MappedFile->MapRegion(0, expectedSize);
+		if (MappedRegion && IsValidHeader(MappedRegion->GetMappedPtr())) {
+			Data = (const uint32*)(MappedRegion->GetMappedPtr() + DISTANCE_TABLE_HEADER_SIZE);
+			return true;
+		}
+	}
+	Unload();
+
+	//No mapping on this platform, read the whole file instead
+	TArray<uint8> bytes;
+	if (!FFileHelper::LoadFileToArray(bytes, *filename, FILEREAD_Silent) || bytes.Num() != expectedSize || !IsValidHeader(bytes.GetData())) {
+		return false;
+	}
+
+	OwnedWords.SetNumUninitialized((NumStates + 7) / 8);
+	FMemory::Memcpy(OwnedWords.GetData(), bytes.GetData() + DISTANCE_TABLE_HEADER_SIZE, OwnedWords.Num() * sizeof(uint32));
+	Data = OwnedWords.GetData();
+	return true;
+}
+
+FString FRubiks2x2DistanceTable::GetDefaultFilename()
+{
+	return FPaths::GameContentDir() / TEXT("Rubiks") / TEXT("Distance2x2.bin");
+}
+
+int32 FRubiks2x2DistanceTable::GetDistance(const FRubiksCubeState& state) const
+{
+	if (!Data || state.GetSize() != 2) {
+		return INDEX_NONE;
+	}
+
+	int32 distance = GetNibble(Rank(state));
+	return distance == DISTANCE_TABLE_UNVISITED ? INDEX_NONE : distance;
+}
+
+bool FRubiks2x2DistanceTable::GetOptimalMove(const FRubiksCubeState& state, FRubiksMove& outMove, int32& outDistance) const
+{
+	outDistance = GetDistance(state);
+	if (outDistance <= 0) {
+		return false;
+	}
+
+	//Try both layers of every axis, in the cube's own frame
+	FRubiksCubeState next;
+	for (int32 axis = 0; axis < 3; axis++) {
+		for (int32 layer = 0; layer < 2; layer++) {
+			for (int32 direction = -1; direction <= 1; direction += 2) {
+				FRubiksMove move((ERotationGroup::RotationGroup)axis, layer, direction);
+				next = state;
+				next.ApplyMove(move);
+				if (GetDistance(next) == outDistance - 1) {
+					outMove = move;
+					return true;
+				}
+			}
+		}
+	}
+
+	return false;
+}
+
+int32 FRubiks2x2DistanceTable::Rank(const FRubiksCubeState& state)
+{
+	return GetCoordinateTables().Rank(state);
+}
+
+void FRubiks2x2DistanceTable::Unrank(int32 index, FRubiksCubeState& outState)
+{
+	GetCoordinateTables().Unrank(index, outState);
+}
+
+FRubiksMove FRubiks2x2DistanceTable::GetMove(int32 moveIndex)
+{
+	return FRubiksMove((ERotationGroup::RotationGroup)(moveIndex / 2), 1, (moveIndex % 2) ? 1 : -1);
+}
+
+int32 FRubiks2x2DistanceTable::ApplyMove(int32 index, int32 moveIndex)
+{
+	const FCoordinateTables& tables = GetCoordinateTables();
+	return tables.PermutationMoves[index / 729][moveIndex] * 729 + tables.TwistMoves[index % 729][moveIndex];
+}
+
+void FRubiks2x2DistanceTable::Unload()
+{
+	Data = NULL;
+
+	delete MappedRegion;
+	MappedRegion = NULL;
+	delete MappedFile;
+	MappedFile = NULL;
+
+	OwnedWords.Empty();
+	DepthCounts.Empty();
+}
+
+void FRubiks2x2DistanceTable::CountDepths()
+{
+	DepthCounts.Empty();
+	for (int32 index = 0; index < NumStates; index++) {
+		int32 distance = GetNibble(index);
+		if (distance == DISTANCE_TABLE_UNVISITED) {
+			continue;
+		}
+		if (distance >= DepthCounts.Num()) {
+			DepthCounts.SetNumZeroed(distance + 1);
+		}
+		DepthCounts[distance]++;
+	}
+}
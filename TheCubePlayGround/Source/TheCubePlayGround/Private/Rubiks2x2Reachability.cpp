@@ -0,0 +1,265 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Rubiks2x2Reachability.h"
+#include "TheCubePlayGround.h"
+#include "RubiksAlgorithm.h"
+#include "Async/ParallelFor.h"
+
+//Frontier words handed to a worker at a time (65536 states)
+#define REACHABILITY_CHUNK_WORDS 2048
+
+namespace
+{
+	//Distance table move turning layer 1 of an axis a quarter turn
+	uint8 GetTableMove(ERotationGroup::RotationGroup axis, int32 direction)
+	{
+		return (uint8)(axis * 2 + (direction > 0 ? 1 : 0));
+	}
+
+	//Cell of a 2x2x2 cube after turning the whole cube
+	int32 RotateCell(const FRubiksCubeState& state, uint8 rotation, int32 cell)
+	{
+		FIntVector doubled = state.GetCellCoordinates(cell) * 2 - FIntVector(1, 1, 1);
+		FIntVector rotated = FRubiksCubeState::RotateAxisVector(rotation, doubled);
+		return state.GetCellIndex((rotated + FIntVector(1, 1, 1)) / 2);
+	}
+}
+
+
+FRubiks2x2Reachability::FRubiks2x2Reachability()
+	: NumMoves(0), TargetDepth(INDEX_NONE)
+{
+	TableMoveStarts.Add(0);
+}
+
+bool FRubiks2x2Reachability::AddMove(const FRubiksAlgorithm& algorithm)
+{
+	if (algorithm.GetSize() != 2) {
+		return false;
+	}
+
+	//Play the algorithm from every rotation of piece 1 in the frame where piece 1 is home.
+	//A layer turn becomes a turn of the matching axis there. Turning the layer piece 1 is in is the same
+	//as turning the whole cube and the other layer back, so only layer 1 turns are left for the distance table.
+	for (uint8 rotation = 0; rotation < NumRotations; rotation++) {
+		uint8 current = rotation;
+
+		for (const FRubiksMove& move : algorithm.GetMoves()) {
+			if (move.IsWholeCube()) {
+				current = FRubiksCubeState::ComposeOrientations(FRubiksCubeState::GetTurnOrientation(move.Axis, move.QuarterTurns), current);
+				continue;
+			}
+
+			FIntVector axisVector(0, 0, 0);
+			axisVector[move.Axis] = 1;
+			axisVector = FRubiksCubeState::RotateAxisVector(FRubiksCubeState::InvertOrientation(current), axisVector);
+
+			ERotationGroup::RotationGroup axis = ERotationGroup::X;
+			int32 sign = 1;
+			for (int32 x = 0; x < 3; x++) {
+				if (axisVector[x] != 0) {
+					axis = (ERotationGroup::RotationGroup)x;
+					sign = axisVector[x];
+				}
+			}
+
+			//The turn seen from that frame, matched against the axis' own turns since the axes don't share a handedness
+			uint8 turn = FRubiksCubeState::GetTurnOrientation(move.Axis, move.QuarterTurns);
+			uint8 localTurn = FRubiksCubeState::ComposeOrientations(FRubiksCubeState::InvertOrientation(current), FRubiksCubeState::ComposeOrientations(turn, current));
+			if (localTurn == 0) {
+				continue;
+			}
+
+			int32 quarterTurns = 2;
+			if (localTurn == FRubiksCubeState::GetTurnOrientation(axis, 1)) {
+				quarterTurns = 1;
+			}
+			else if (localTurn == FRubiksCubeState::GetTurnOrientation(axis, -1)) {
+				quarterTurns = -1;
+			}
+
+			int32 layer = sign > 0 ? move.Layer : 1 - move.Layer;
+			if (layer == 0) {
+				current = FRubiksCubeState::ComposeOrientations(current, FRubiksCubeState::GetTurnOrientation(axis, quarterTurns));
+				quarterTurns = -quarterTurns;
+			}
+
+			for (int32 x = 0; x < FMath::Abs(quarterTurns); x++) {
+				TableMoves.Add(GetTableMove(axis, quarterTurns));
+			}
+		}
+
+		NextRotations.Add(current);
+		TableMoveStarts.Add(TableMoves.Num());
+	}
+
+	NumMoves++;
+	return true;
+}
+
+void FRubiks2x2Reachability::Search(const FRubiksCubeState& start, const TArray<int32>& targets)
+{
+	int32 numWords = (NumStates + 31) / 32;
+	Visited.Init(0, numWords);
+	TArray<uint32> frontier;
+	TArray<uint32> next;
+	frontier.Init(0, numWords);
+	next.Init(0, numWords);
+
+	DepthCounts.Empty();
+	TargetDepth = INDEX_NONE;
+
+	int32 startIndex = GetIndex(start);
+	SetBit(Visited, startIndex);
+	SetBit(frontier, startIndex);
+	DepthCounts.Add(1);
+
+	int32 numChunks = (numWords + REACHABILITY_CHUNK_WORDS - 1) / REACHABILITY_CHUNK_WORDS;
+	for (int32 depth = 0; ; depth++) {
+		for (int32 target : targets) {
+			if (TargetDepth == INDEX_NONE && GetBit(frontier, target)) {
+				TargetDepth = depth;
+			}
+		}
+
+		volatile int32 found = 0;
+
+		//Each worker expands the states of a range of frontier words, the new states are claimed in Visited
+		ParallelFor(numChunks, [&](int32 chunk)
+		{
+			int32 chunkFound = 0;
+			int32 first = chunk * REACHABILITY_CHUNK_WORDS;
+			int32 last = FMath::Min(first + REACHABILITY_CHUNK_WORDS, numWords);
+
+			for (int32 word = first; word < last; word++) {
+				uint32 bits = frontier[word];
+				while (bits != 0) {
+					int32 index = word * 32 + FMath::CountTrailingZeros(bits);
+					bits &= bits - 1;
+
+					int32 tableIndex = index / NumRotations;
+					int32 rotation = index % NumRotations;
+					for (int32 m = 0; m < NumMoves; m++) {
+						int32 transition = m * NumRotations + rotation;
+						int32 nextTableIndex = tableIndex;
+						for (int32 x = TableMoveStarts[transition]; x < TableMoveStarts[transition + 1]; x++) {
+							nextTableIndex = FRubiks2x2DistanceTable::ApplyMove(nextTableIndex, TableMoves[x]);
+						}
+
+						int32 nextIndex = nextTableIndex * NumRotations + NextRotations[transition];
+						if (SetBit(Visited, nextIndex)) {
+							SetBit(next, nextIndex);
+							chunkFound++;
+						}
+					}
+				}
+			}
+
+			FPlatformAtomics::InterlockedAdd(&found, chunkFound);
+		});
+
+		if (found == 0) {
+			break;
+		}
+
+		DepthCounts.Add((int32)found);
+		Swap(frontier, next);
+		FMemory::Memzero(next.GetData(), numWords * sizeof(uint32));
+	}
+}
+
+bool FRubiks2x2Reachability::IsReachable(int32 index) const
+{
+	return Visited.IsValidIndex(index >> 5) && GetBit(Visited, index);
+}
+
+int64 FRubiks2x2Reachability::GetNumReached() const
+{
+	int64 reached = 0;
+	for (int32 count : DepthCounts) {
+		reached += count;
+	}
+	return reached;
+}
+
+int32 FRubiks2x2Reachability::GetIndex(const FRubiksCubeState& state)
+{
+	return FRubiks2x2DistanceTable::Rank(state) * NumRotations + state.GetPieceOrientation(0);
+}
+
+void FRubiks2x2Reachability::GetState(int32 index, FRubiksCubeState& outState)
+{
+	FRubiksCubeState normalized;
+	FRubiks2x2DistanceTable::Unrank(index / NumRotations, normalized);
+
+	//Turn the whole cube back from piece 1 at home to its actual rotation
+	uint8 rotation = (uint8)(index % NumRotations);
+	outState.Reset(2);
+	for (int32 piece = 0; piece < normalized.GetNumPieces(); piece++) {
+		outState.SetPiece(piece, RotateCell(normalized, rotation, normalized.GetPieceCell(piece)),
+			FRubiksCubeState::ComposeOrientations(rotation, normalized.GetPieceOrientation(piece)));
+	}
+}
+
+void FRubiks2x2Reachability::GetStatesWithPieceCells(const TArray<int32>& pieceCells, TArray<int32>& outIndices)
+{
+	outIndices.Empty();
+
+	FRubiksCubeState state;
+	state.Reset(2);
+	int32 numPieces = state.GetNumPieces();
+	if (pieceCells.Num() != numPieces) {
+		return;
+	}
+
+	//The three rotations that take each piece from its home cell to the wanted cell
+	const FRubiksCubeLayout& layout = FRubiksCubeLayout::Get(2);
+	TArray<TArray<uint8>> pieceOrientations;
+	pieceOrientations.SetNum(numPieces);
+	for (int32 piece = 0; piece < numPieces; piece++) {
+		for (uint8 orientation = 0; orientation < NumRotations; orientation++) {
+			if (RotateCell(state, orientation, layout.HomeCells[piece]) == pieceCells[piece]) {
+				pieceOrientations[piece].Add(orientation);
+			}
+		}
+	}
+
+	//Try every combination, only those that turn into the same state again can be reached by turning layers
+	int32 numCombinations = 1;
+	for (int32 piece = 0; piece < numPieces; piece++) {
+		numCombinations *= pieceOrientations[piece].Num();
+	}
+
+	FRubiksCubeState check;
+	for (int32 combination = 0; combination < numCombinations; combination++) {
+		int32 remaining = combination;
+		for (int32 piece = 0; piece < numPieces; piece++) {
+			int32 numOrientations = pieceOrientations[piece].Num();
+			state.SetPiece(piece, pieceCells[piece], pieceOrientations[piece][remaining % numOrientations]);
+			remaining /= numOrientations;
+		}
+
+		int32 index = GetIndex(state);
+		GetState(index, check);
+		if (check == state) {
+			outIndices.AddUnique(index);
+		}
+	}
+}
+
+bool FRubiks2x2Reachability::SetBit(TArray<uint32>& bits, int32 index)
+{
+	volatile int32* word = (volatile int32*)&bits[index >> 5];
+	uint32 mask = 1u << (index & 31);
+
+	while (true) {
+		uint32 oldWord = (uint32)*word;
+		if (oldWord & mask) {
+			return false;
+		}
+
+		if (FPlatformAtomics::InterlockedCompareExchange(word, (int32)(oldWord | mask), (int32)oldWord) == (int32)oldWord) {
+			return true;
+		}
+	}
+}
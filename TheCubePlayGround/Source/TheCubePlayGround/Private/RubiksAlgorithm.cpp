@@ -0,0 +1,420 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RubiksAlgorithm.h"
+#include "TheCubePlayGround.h"
+#include "Misc/ScopeLock.h"
+
+
+namespace
+{
+	//Groups can't expand past this many layer turns, so "((R)99)99" style typos can't run away
+	const int32 MaxAlgorithmMoves = 100000;
+
+	//The cache starts over past this many algorithms, cubes keep the ones they are playing alive
+	const int32 MaxCachedAlgorithms = 256;
+
+	struct FAlgorithmStep
+	{
+		TArray<FRubiksMove, TInlineAllocator<4>> Moves;
+	};
+
+	//How a face letter turns: the axis, whether its outer layer is the last one of the axis and the sign of a clockwise turn
+	struct FFaceTurn
+	{
+		ERotationGroup::RotationGroup Axis;
+		bool bOuterLayerIsLast;
+		int32 Sign;
+	};
+
+	//Same turns as ARubiksCube::GetFaceRotation for the clockwise rotation of each face
+	bool GetFaceTurn(TCHAR letter, FFaceTurn& outTurn)
+	{
+		switch (FChar::ToUpper(letter))
+		{
+			case 'U': outTurn = { ERotationGroup::Z, true, 1 }; return true;
+			case 'D': outTurn = { ERotationGroup::Z, false, -1 }; return true;
+			case 'F': outTurn = { ERotationGroup::X, false, 1 }; return true;
+			case 'B': outTurn = { ERotationGroup::X, true, -1 }; return true;
+			case 'R': outTurn = { ERotationGroup::Y, false, 1 }; return true;
+			case 'L': outTurn = { ERotationGroup::Y, true, -1 }; return true;
+			default: return false;
+		}
+	}
+
+	class FAlgorithmParser
+	{
+	public:
+		FString Error;
+
+		FAlgorithmParser(const FString& notation, int32 size)
+			: Text(*notation), Length(notation.Len()), Position(0), Size(size), NumMoves(0)
+		{
+		}
+
+		bool ParseSequence(TArray<FAlgorithmStep>& outSteps, bool inGroup)
+		{
+			while (true) {
+				SkipSpaces();
+
+				TCHAR c = Peek();
+				if (c == 0) {
+					return inGroup ? Fail(TEXT("missing ')'")) : true;
+				}
+
+				if (c == ')') {
+					return inGroup ? true : Fail(TEXT("unexpected ')'"));
+				}
+
+				if (c == '(') {
+					Position++;
+
+					TArray<FAlgorithmStep> group;
+					if (!ParseSequence(group, true)) {
+						return false;
+					}
+					Position++;
+
+					int32 count;
+					bool prime;
+					if (!ParseSuffix(count, prime)) {
+						return false;
+					}
+
+					if (prime) {
+						InvertSteps(group);
+					}
+
+					for (int32 x = 0; x < count; x++) {
+						if (!AddSteps(outSteps, group)) {
+							return false;
+						}
+					}
+					continue;
+				}
+
+				if (!ParseMove(outSteps)) {
+					return false;
+				}
+			}
+		}
+
+	private:
+		const TCHAR* Text;
+		int32 Length;
+		int32 Position;
+		int32 Size;
+		int32 NumMoves;
+
+		TCHAR Peek() const { return Position < Length ? Text[Position] : 0; }
+
+		//Straight quote or the typographic one text editors like to swap in
+		static bool IsPrime(TCHAR c) { return c == '\'' || c == 0x2019; }
+
+		void SkipSpaces()
+		{
+			while (Position < Length && FChar::IsWhitespace(Text[Position])) {
+				Position++;
+			}
+		}
+
+		bool ReadNumber(int32& outValue)
+		{
+			if (!FChar::IsDigit(Peek())) {
+				return false;
+			}
+
+			int32 value = 0;
+			while (FChar::IsDigit(Peek())) {
+				value = FMath::Min(value * 10 + (Text[Position] - '0'), 9999);
+				Position++;
+			}
+			outValue = value;
+			return true;
+		}
+
+		bool Fail(const TCHAR* message)
+		{
+			Error = FString::Printf(TEXT("%s at character %d"), message, Position + 1);
+			return false;
+		}
+
+		//Count and prime after a move or a group: "2", "'", "2'" or "'2"
+		bool ParseSuffix(int32& outCount, bool& outPrime)
+		{
+			outCount = 1;
+			outPrime = false;
+
+			bool hasCount = ReadNumber(outCount);
+			if (IsPrime(Peek())) {
+				outPrime = true;
+				Position++;
+				if (!hasCount) {
+					ReadNumber(outCount);
+				}
+			}
+
+			if (outCount == 0) {
+				return Fail(TEXT("a move can't be repeated 0 times"));
+			}
+			return true;
+		}
+
+		bool ParseMove(TArray<FAlgorithmStep>& outSteps)
+		{
+			//Layer prefix: "2R" or "2-3Rw"
+			int32 firstDepth = 0;
+			int32 lastDepth = 0;
+			bool hasPrefix = ReadNumber(firstDepth);
+			bool hasRange = false;
+			lastDepth = firstDepth;
+			if (hasPrefix && Peek() == '-') {
+				Position++;
+				if (!ReadNumber(lastDepth)) {
+					return Fail(TEXT("expected a layer number"));
+				}
+				hasRange = true;
+			}
+
+			TCHAR letter = Peek();
+			if (letter == 0) {
+				return Fail(TEXT("expected a move"));
+			}
+			Position++;
+
+			ERotationGroup::RotationGroup axis;
+			int32 sign = 1;
+			TArray<int32, TInlineAllocator<8>> layers;
+
+			FFaceTurn face;
+			if (GetFaceTurn(letter, face)) {
+				bool wide = FChar::IsLower(letter);
+				if (!wide && Peek() == 'w') {
+					wide = true;
+					Position++;
+				}
+
+				if (wide && !hasRange) {
+					lastDepth = hasPrefix ? firstDepth : 2;
+					firstDepth = 1;
+				}
+				else if (!hasPrefix) {
+					firstDepth = 1;
+					lastDepth = 1;
+				}
+
+				if (firstDepth < 1 || lastDepth < firstDepth || lastDepth > Size) {
+					return Fail(TEXT("layer out of range for this cube"));
+				}
+
+				axis = face.Axis;
+				sign = face.Sign;
+				for (int32 depth = firstDepth; depth <= lastDepth; depth++) {
+					layers.Add(face.bOuterLayerIsLast ? Size - depth : depth - 1);
+				}
+			}
+			else if (letter == 'M' || letter == 'E' || letter == 'S') {
+				if (hasPrefix) {
+					return Fail(TEXT("slice moves take no layer number"));
+				}
+				if (Size < 3) {
+					return Fail(TEXT("slice moves need a cube with inner layers"));
+				}
+
+				//Turn like L, D and F
+				GetFaceTurn(letter == 'M' ? 'L' : (letter == 'E' ? 'D' : 'F'), face);
+				axis = face.Axis;
+				sign = face.Sign;
+				for (int32 layer = 1; layer < Size - 1; layer++) {
+					layers.Add(layer);
+				}
+			}
+			else if (letter == 'x' || letter == 'y' || letter == 'z') {
+				if (hasPrefix) {
+					return Fail(TEXT("cube rotations take no layer number"));
+				}
+
+				//Turn like R, U and F
+				GetFaceTurn(letter == 'x' ? 'R' : (letter == 'y' ? 'U' : 'F'), face);
+				axis = face.Axis;
+				sign = face.Sign;
+				layers.Add(INDEX_NONE);
+			}
+			else {
+				Position--;
+				return Fail(TEXT("unknown move"));
+			}
+
+			int32 count;
+			bool prime;
+			if (!ParseSuffix(count, prime)) {
+				return false;
+			}
+
+			//Keep the direction of half turns, it only matters for the animation
+			int32 quarterTurns = (count % 4) * (prime ? -1 : 1);
+			if (quarterTurns == 3 || quarterTurns == -3) {
+				quarterTurns = quarterTurns > 0 ? -1 : 1;
+			}
+			if (quarterTurns == 0) {
+				return true;
+			}
+
+			FAlgorithmStep step;
+			for (int32 layer : layers) {
+				step.Moves.Add(FRubiksMove(axis, layer, quarterTurns * sign));
+			}
+
+			TArray<FAlgorithmStep> steps;
+			steps.Add(step);
+			return AddSteps(outSteps, steps);
+		}
+
+		bool AddSteps(TArray<FAlgorithmStep>& outSteps, const TArray<FAlgorithmStep>& steps)
+		{
+			for (const FAlgorithmStep& step : steps) {
+				NumMoves += step.Moves.Num();
+				if (NumMoves > MaxAlgorithmMoves) {
+					return Fail(TEXT("algorithm is too long"));
+				}
+				outSteps.Add(step);
+			}
+			return true;
+		}
+
+		static void InvertSteps(TArray<FAlgorithmStep>& steps)
+		{
+			for (int32 x = 0; x < steps.Num() / 2; x++) {
+				Swap(steps[x], steps[steps.Num() - 1 - x]);
+			}
+			for (FAlgorithmStep& step : steps) {
+				for (FRubiksMove& move : step.Moves) {
+					move = move.GetInverse();
+				}
+			}
+		}
+	};
+
+	FCriticalSection& GetCacheLock()
+	{
+		static FCriticalSection CacheLock;
+		return CacheLock;
+	}
+
+	TMap<FString, FRubiksAlgorithmPtr>& GetCache()
+	{
+		static TMap<FString, FRubiksAlgorithmPtr> Cache;
+		return Cache;
+	}
+}
+
+
+FRubiksAlgorithm::FRubiksAlgorithm()
+	: Size(0)
+{
+}
+
+FRubiksAlgorithmPtr FRubiksAlgorithm::FindOrCompile(const FString& notation, int32 size, FString& outError)
+{
+	FString key = FString::Printf(TEXT("%d|%s"), size, *notation);
+
+	{
+		FScopeLock lock(&GetCacheLock());
+		FRubiksAlgorithmPtr* found = GetCache().Find(key);
+		if (found) {
+			return *found;
+		}
+	}
+
+	//Compile outside the lock, two threads compiling the same algorithm just end up sharing one of them
+	TSharedPtr<FRubiksAlgorithm, ESPMode::ThreadSafe> algorithm = MakeShareable(new FRubiksAlgorithm());
+	if (!algorithm->Compile(notation, size, outError)) {
+		return FRubiksAlgorithmPtr();
+	}
+
+	FScopeLock lock(&GetCacheLock());
+	FRubiksAlgorithmPtr* found = GetCache().Find(key);
+	if (found) {
+		return *found;
+	}
+	if (GetCache().Num() >= MaxCachedAlgorithms) {
+		GetCache().Empty();
+	}
+	return GetCache().Add(key, algorithm);
+}
+
+void FRubiksAlgorithm::ClearCache()
+{
+	FScopeLock lock(&GetCacheLock());
+	GetCache().Empty();
+}
+
+bool FRubiksAlgorithm::Parse(const FString& notation, int32 size, TArray<FRubiksMove>& outMoves, TArray<int32>& outStepStarts, FString& outError)
+{
+	outMoves.Reset();
+	outStepStarts.Reset();
+
+	if (size < 1) {
+		outError = TEXT("invalid cube size");
+		return false;
+	}
+
+	FAlgorithmParser parser(notation, size);
+	TArray<FAlgorithmStep> steps;
+	if (!parser.ParseSequence(steps, false)) {
+		outError = parser.Error;
+		return false;
+	}
+
+	for (const FAlgorithmStep& step : steps) {
+		outStepStarts.Add(outMoves.Num());
+		outMoves.Append(step.Moves);
+	}
+	return true;
+}
+
+bool FRubiksAlgorithm::Compile(const FString& notation, int32 size, FString& outError)
+{
+	if (!Parse(notation, size, Moves, StepStarts, outError)) {
+		return false;
+	}
+
+	Notation = notation;
+	Size = size;
+
+	//Play the moves once from solved: each piece then shows where its home cell's piece goes and how it turns
+	FRubiksCubeState state;
+	state.Reset(size);
+	for (const FRubiksMove& move : Moves) {
+		state.ApplyMove(move);
+	}
+
+	const FRubiksCubeLayout& layout = FRubiksCubeLayout::Get(size);
+	CellTargets.Init(INDEX_NONE, size * size * size);
+	OrientationDeltas.Init(0, size * size * size);
+	for (int32 x = 0; x < layout.HomeCells.Num(); x++) {
+		CellTargets[layout.HomeCells[x]] = state.GetPieceCell(x);
+		OrientationDeltas[layout.HomeCells[x]] = state.GetPieceOrientation(x);
+	}
+
+	return true;
+}
+
+void FRubiksAlgorithm::Apply(FRubiksCubeState& state) const
+{
+	if (state.GetSize() != Size) {
+		return;
+	}
+
+	state.ApplyCellPermutation(CellTargets, OrientationDeltas);
+}
+
+void FRubiksAlgorithm::GetStep(int32 stepIndex, int32& outFirstMove, int32& outNumMoves) const
+{
+	outFirstMove = StepStarts[stepIndex];
+	outNumMoves = (stepIndex + 1 < StepStarts.Num() ? StepStarts[stepIndex + 1] : Moves.Num()) - outFirstMove;
+}
+
+SIZE_T FRubiksAlgorithm::GetAllocatedSize() const
+{
+	return Notation.GetAllocatedSize() + Moves.GetAllocatedSize() + StepStarts.GetAllocatedSize() + CellTargets.GetAllocatedSize() + OrientationDeltas.GetAllocatedSize();
+}
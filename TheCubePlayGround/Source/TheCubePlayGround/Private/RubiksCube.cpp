@@ -3,15 +3,24 @@
 #include "RubiksCube.h"
 #include "TheCubePlayGround.h"
 #include "RubiksPiece.h"
+#include "RubiksHintSolver.h"
+#include "RubiksTranspositionCache.h"
+#include "Rubiks2x2DistanceTable.h"
+#include "RubiksCubeManager.h"
 #include "Kismet/GameplayStatics.h"
+#include "Components/BoxComponent.h"
+#include "Engine/CollisionProfile.h"
+#include "Engine/BlueprintGeneratedClass.h"
+#include "Engine/SimpleConstructionScript.h"
+#include "Engine/SCS_Node.h"
 #include "Engine/World.h"
 #include "DrawDebugHelpers.h"
 
 // Sets default values
 ARubiksCube::ARubiksCube()
 {
-	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
+	//Rotations are animated by ARubiksCubeManager, the cube itself never ticks
+	PrimaryActorTick.bCanEverTick = false;
 
 
 	//Set default cube size
@@ -32,15 +41,26 @@ ARubiksCube::ARubiksCube()
 
 
 	this->CubeExtentScale = 1.0;
+	this->bDisablePieceQueryCollision = false;
 	this->totalRotationTime = 1.0;
-	passRotationTime = 0.0;
+	this->HistoryCheckpointInterval = 32;
+	this->MaxHistoryMoves = 4096;
 	isRotating = false;
 	destRotation = FRotator(0, 0, 0);
 
 
 	potentialRotationGroup = ERotationGroup::RotationGroup::X;
 	potentialRotator = FRotator(0, 0, 0);
-	potentialPiece = NULL;
+	potentialPieceID = INDEX_NONE;
+	PlayingStep = 0;
+
+	bRecordTelemetry = false;
+	LastInputTime = 0;
+	PendingSinceLastInput = 0;
+	bWasSolved = true;
+
+	bForceLogicalOnly = false;
+	bLogicalOnly = false;
 }
 
 // Called when the game starts or when spawned
@@ -48,45 +68,79 @@ void ARubiksCube::BeginPlay()
 {
 	Super::BeginPlay();
 
+	//Start the writer thread now rather than on the first move
+	if (this->bRecordTelemetry) {
+		FRubiksTelemetry::Get();
+	}
+
 	//Build Cube Pieces
 	this->BuildCube(this->CubeSize);
 
 }
 
-// Called every frame
-void ARubiksCube::Tick(float DeltaTime)
+void ARubiksCube::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	Super::Tick(DeltaTime);
+	PlayingAlgorithm.Reset();
 
+	if (RotationManager.IsValid()) {
+		RotationManager->RemoveRotation(this);
+	}
 
-	if (isRotating) {
-		passRotationTime += DeltaTime;
+	Super::EndPlay(EndPlayReason);
+}
 
-		float portionRotate = passRotationTime / totalRotationTime;
+// Called by the cube manager once the layer has turned all the way
+void ARubiksCube::FinishLayerRotation()
+{
+	isRotating = false;
+	destRotation = FRotator(0, 0, 0);
 
-		portionRotate = FMath::Clamp(portionRotate, 0.0f, 1.0f);
-		
-		PieceRotator->SetRelativeRotation(portionRotate * destRotation);
+	//The layers got there, only now does the logical state (and history and telemetry) see the move
+	for (const FRubiksMove& move : PendingMoves) {
+		CommitMove(move);
+	}
+	PendingMoves.Reset();
 
-		if (passRotationTime > totalRotationTime) {
-			isRotating = false;
-			passRotationTime = 0.0;
-			destRotation = FRotator(0, 0, 0);
-		}
+	//Put the rotated pieces back on the cube, exactly where the logical state says they are
+	TArray<int32> rotatedPieces;
+	for (int32 x = 0; x < PiecesToRotate.Num(); x++) {
+		rotatedPieces.Add(PiecesToRotate[x]->cubePieceID - 1);
 	}
+	PiecesToRotate.Empty();
+	SyncPiecesToLogicalState(rotatedPieces);
+	DisableCollisionProxies();
+	PieceRotator->SetRelativeRotation(FRotator(0, 0, 0));
 
+	//Carry on with the algorithm being played
+	if (PlayingAlgorithm.IsValid()) {
+		PlayNextAlgorithmStep();
+	}
 }
 
 void ARubiksCube::DestroyCube()
 {
+	//Drop a rotation in progress, its moves are never committed
+	if (RotationManager.IsValid()) {
+		RotationManager->RemoveRotation(this);
+	}
+	isRotating = false;
+	PendingMoves.Reset();
+
 	PiecesToRotate.Empty();
 	for (int32 x = 0; x < Pieces.Num(); x++) {
 		Pieces[x]->Destroy();
 	}
 
 	Pieces.Empty();
+	DisableCollisionProxies();
+	PlayingAlgorithm.Reset();
 	PieceRotator->SetRelativeRotation(FRotator(0, 0, 0));
 	SelfRotator->SetRelativeRotation(FRotator(0, 0, 0));
+
+	//No pieces left to turn, undo or give hints for until the next BuildCube
+	LogicalState = FRubiksCubeState();
+	MoveHistory.Reset(LogicalState, this->HistoryCheckpointInterval, this->MaxHistoryMoves);
+	bWasSolved = true;
 }
 
 void ARubiksCube::BuildCube(int32 size)
@@ -105,6 +159,19 @@ void ARubiksCube::BuildCube(int32 size)
 
 	int32 cubePieceID = 1;
 
+	PlayingAlgorithm.Reset();
+	PendingMoves.Reset();
+	LogicalState.Reset(this->CubeSize);
+	bWasSolved = true;
+	MoveHistory.Reset(LogicalState, this->HistoryCheckpointInterval, this->MaxHistoryMoves);
+
+	//Dedicated servers only need the logical state, skip the piece actors altogether
+	bLogicalOnly = this->bForceLogicalOnly || GetNetMode() == NM_DedicatedServer;
+	if (bLogicalOnly) {
+		UE_LOG(LogTemp, Warning, TEXT("Logical only cube creation!"));
+		return;
+	}
+
 	UE_LOG(LogTemp, Warning, TEXT("Cube Creation!"));
 	//Create cube based on its size
 	for (int i = 0; i < this->CubeSize; i++) {
@@ -120,6 +187,16 @@ void ARubiksCube::BuildCube(int32 size)
 					piece->Tags.Add(CUBE_PIECE_TAG);
 					piece->cubePieceID = cubePieceID++;
 					Pieces.Add(piece);
+
+					if (this->bDisablePieceQueryCollision) {
+						//Only the trace channels ignore the pieces: movement sweeps and overlaps are queries too, pawns must still collide
+						TInlineComponentArray<UPrimitiveComponent*> primitives;
+						piece->GetComponents(primitives);
+						for (UPrimitiveComponent* primitive : primitives) {
+							primitive->SetCollisionResponseToChannel(ECC_Visibility, ECR_Ignore);
+							primitive->SetCollisionResponseToChannel(ECC_Camera, ECR_Ignore);
+						}
+					}
 				}
 			}
 		}
@@ -155,8 +232,7 @@ void ARubiksCube::Scramble()
 	}
 
 	//Choose a random piece for the group
-	random = FMath::RandRange(0, Pieces.Num() - 1);
-	ARubiksPiece * randomPiece = Pieces[random];
+	int32 randomPieceID = FMath::RandRange(1, LogicalState.GetNumPieces());
 
 	//Choose a random direction
 	random = FMath::RandRange(0, 1);
@@ -165,188 +241,313 @@ void ARubiksCube::Scramble()
 	}
 
 	//Scramble!
-	RotateGroup(FName("Scramble"), randomPiece, rotationGroupAxis, angle);
+	RotateGroup(FName("Scramble"), randomPieceID, rotationGroupAxis, angle);
 }
 
 
 bool ARubiksCube::IsCubeSolved()
 {
-	bool solved = true;
-	for (int x = 0; x < Pieces.Num(); x++) {
-		if (!Pieces[x]->IsAtStartPosition()) {
-			solved = false;
-			break;
-		}
-	}
-
-	return solved;
+	//Every piece back at its start position, read from the logical state so it also works without piece actors.
+	//A destroyed cube has no piece out of place.
+	return LogicalState.GetNumPieces() == 0 || LogicalState.IsSolved();
 }
 
 
 int32 ARubiksCube::RotateFromPieceClockwise(FVector normal, class ARubiksPiece * piece) {
-	if (this->isRotating) {
-		return -1;
-	}
-
-	UE_LOG(LogActor, Warning, TEXT("Rotate From Piece Clockwise!"));
-	if (normal.Equals(FVector(0, 0, 1))) { //Top Face
-		UE_LOG(LogActor, Warning, TEXT("Top face!"));
+	return RotateFromPieceIDClockwise(normal, piece ? piece->cubePieceID : INDEX_NONE);
+}
 
-		RotateGroup(FName("Group Rotation"), piece, ERotationGroup::RotationGroup::Z, FRotator(0, 90, 0));
 
-		return 1;
-	}
-	else if (normal.Equals(FVector(0, 0, -1))) { //Bottom Face
-		UE_LOG(LogActor, Warning, TEXT("Bottom face!"));
+int32 ARubiksCube::RotateFromPieceCounterClockwise(FVector normal, class ARubiksPiece * piece) {
+	return RotateFromPieceIDCounterClockwise(normal, piece ? piece->cubePieceID : INDEX_NONE);
+}
 
-		RotateGroup(FName("Group Rotation"), piece, ERotationGroup::RotationGroup::Z, FRotator(0, -90, 0));
 
-		return 2;
-	}
-	else if (normal.Equals(FVector(1, 0, 0))) { //Back face
-		UE_LOG(LogActor, Warning, TEXT("Back face!"));
+int32 ARubiksCube::RotateFromPieceIDClockwise(FVector normal, int32 pieceID) {
+	return RotateFromPieceIDInternal(normal, pieceID, true, false);
+}
 
-		RotateGroup(FName("Group Rotation"), piece, ERotationGroup::RotationGroup::X, FRotator(0, 0, -90));
 
-		return 3;
-	}
-	else if (normal.Equals(FVector(-1, 0, 0))) { //Front Face
-		UE_LOG(LogActor, Warning, TEXT("Front face!"));
+int32 ARubiksCube::RotateFromPieceIDCounterClockwise(FVector normal, int32 pieceID) {
+	return RotateFromPieceIDInternal(normal, pieceID, false, false);
+}
 
-		RotateGroup(FName("Group Rotation"), piece, ERotationGroup::RotationGroup::X, FRotator(0, 0, 90));
 
-		return 4;
+int32 ARubiksCube::RotateFromPieceIDInternal(FVector normal, int32 pieceID, bool clockwise, bool deferred) {
+	float sinceLastInput = NoteInput();
+	if (this->isRotating) {
+		RecordTelemetry(ERubiksTelemetryEvent::RejectedInput, FRubiksMove(ERotationGroup::X, INDEX_NONE, 0), sinceLastInput, pieceID);
+		return -1;
 	}
-	else if (normal.Equals(FVector(0, -1, 0))) { //Right Face
-		UE_LOG(LogActor, Warning, TEXT("Right face!"));
+	PendingSinceLastInput = sinceLastInput;
 
-		RotateGroup(FName("Group Rotation"), piece, ERotationGroup::RotationGroup::Y, FRotator(90, 0, 0));
+	if (clockwise) {
+		UE_LOG(LogActor, Warning, TEXT("Rotate From Piece Clockwise!"));
+	}
+	else {
+		UE_LOG(LogActor, Warning, TEXT("Rotate From Piece Counter Clockwise!"));
+	}
 
-		return 5;
+	ERotationGroup::RotationGroup groupAxis;
+	FRotator rotation;
+	int32 face = GetFaceRotation(normal, clockwise, groupAxis, rotation);
+	if (face == -1) {
+		return -1;
 	}
-	else if (normal.Equals(FVector(0, 1, 0))) { //Left Face
-		UE_LOG(LogActor, Warning, TEXT("Left face!"));
 
-		RotateGroup(FName("Group Rotation"), piece, ERotationGroup::RotationGroup::Y, FRotator(-90, 0, 0));
+	//Checked here too so a deferred rotation is never accepted for a piece RotateGroup will reject
+	if (pieceID < 1 || pieceID > LogicalState.GetNumPieces()) {
+		UE_LOG(LogActor, Warning, TEXT("input piece is not part of this cube!"));
+		return -1;
+	}
 
-		return 6;
+	if (deferred) {
+		//Wait for RotateFromPieceDoRotation
+		potentialRotationGroup = groupAxis;
+		potentialPieceID = pieceID;
+		potentialRotator = rotation;
+	}
+	else if (!RotateGroup(FName("Group Rotation"), pieceID, groupAxis, rotation)) {
+		return -1;
 	}
 
-	return -1;
+	return face;
 }
 
 
-int32 ARubiksCube::RotateFromPieceCounterClockwise(FVector normal, class ARubiksPiece * piece) {
-	if (this->isRotating) {
-		return -1;
-	}
+int32 ARubiksCube::GetFaceRotation(FVector worldNormal, bool clockwise, ERotationGroup::RotationGroup& groupAxis, FRotator& rotation) {
+	int32 face = -1;
+
+	//Faces are relative to the cube, so a rotated cube still turns the right group
+	FVector normal = GetActorTransform().InverseTransformVectorNoScale(worldNormal);
 
-	UE_LOG(LogActor, Warning, TEXT("Rotate From Piece Clockwise!"));
 	if (normal.Equals(FVector(0, 0, 1))) { //Top Face
 		UE_LOG(LogActor, Warning, TEXT("Top face!"));
 
-		RotateGroup(FName("Group Rotation"), piece, ERotationGroup::RotationGroup::Z, FRotator(0, -90, 0));
-
-		return 1;
+		groupAxis = ERotationGroup::RotationGroup::Z;
+		rotation = FRotator(0, 90, 0);
+		face = 1;
 	}
 	else if (normal.Equals(FVector(0, 0, -1))) { //Bottom Face
 		UE_LOG(LogActor, Warning, TEXT("Bottom face!"));
 
-		RotateGroup(FName("Group Rotation"), piece, ERotationGroup::RotationGroup::Z, FRotator(0, 90, 0));
-
-		return 2;
+		groupAxis = ERotationGroup::RotationGroup::Z;
+		rotation = FRotator(0, -90, 0);
+		face = 2;
 	}
 	else if (normal.Equals(FVector(1, 0, 0))) { //Back face
 		UE_LOG(LogActor, Warning, TEXT("Back face!"));
 
-		RotateGroup(FName("Group Rotation"), piece, ERotationGroup::RotationGroup::X, FRotator(0, 0, 90));
-
-		return 3;
+		groupAxis = ERotationGroup::RotationGroup::X;
+		rotation = FRotator(0, 0, -90);
+		face = 3;
 	}
 	else if (normal.Equals(FVector(-1, 0, 0))) { //Front Face
 		UE_LOG(LogActor, Warning, TEXT("Front face!"));
 
-		RotateGroup(FName("Group Rotation"), piece, ERotationGroup::RotationGroup::X, FRotator(0, 0, -90));
-
-		return 4;
+		groupAxis = ERotationGroup::RotationGroup::X;
+		rotation = FRotator(0, 0, 90);
+		face = 4;
 	}
 	else if (normal.Equals(FVector(0, -1, 0))) { //Right Face
 		UE_LOG(LogActor, Warning, TEXT("Right face!"));
 
-		RotateGroup(FName("Group Rotation"), piece, ERotationGroup::RotationGroup::Y, FRotator(-90, 0, 0));
-
-		return 5;
+		groupAxis = ERotationGroup::RotationGroup::Y;
+		rotation = FRotator(90, 0, 0);
+		face = 5;
 	}
 	else if (normal.Equals(FVector(0, 1, 0))) { //Left Face
 		UE_LOG(LogActor, Warning, TEXT("Left face!"));
 
-		RotateGroup(FName("Group Rotation"), piece, ERotationGroup::RotationGroup::Y, FRotator(90, 0, 0));
+		groupAxis = ERotationGroup::RotationGroup::Y;
+		rotation = FRotator(-90, 0, 0);
+		face = 6;
+	}
 
-		return 6;
+	//Counter clockwise turns the same group the other way
+	if (face != -1 && !clockwise) {
+		rotation = rotation * -1;
 	}
 
-	return -1;
+	return face;
 }
 
 
 
-void ARubiksCube::RotateGroup(FName tweenName, class ARubiksPiece* piece, ERotationGroup::RotationGroup groupAxis, FRotator rotation)
+bool ARubiksCube::RotateGroup(FName tweenName, int32 pieceID, ERotationGroup::RotationGroup groupAxis, FRotator rotation)
+{
+	if (pieceID < 1 || pieceID > LogicalState.GetNumPieces()) {
+		UE_LOG(LogActor, Warning, TEXT("input piece is not part of this cube!"));
+		return false;
+	}
+
+	//Turn the rotator into a logical move on the layer the given piece is in
+	float angle = rotation.Roll;
+	if (groupAxis == ERotationGroup::RotationGroup::Y) {
+		angle = rotation.Pitch;
+	}
+	else if (groupAxis == ERotationGroup::RotationGroup::Z) {
+		angle = rotation.Yaw;
+	}
+
+	FIntVector cell = LogicalState.GetCellCoordinates(LogicalState.GetPieceCell(pieceID - 1));
+
+	BeginLayerRotation(FRubiksMove(groupAxis, cell[groupAxis], FMath::RoundToInt(angle / 90.0f)));
+	return true;
+}
+
+void ARubiksCube::BeginLayerRotation(const FRubiksMove& move)
+{
+	BeginLayerRotation(&move, 1);
+}
+
+void ARubiksCube::BeginLayerRotation(const FRubiksMove* moves, int32 numMoves)
 {
 	//Clean array of the pieces that will rotate
 	PiecesToRotate.Empty();
 
-	//Remove parent from all pieces
-	for (int32 x = 0; x < Pieces.Num(); x++) {
-		Pieces[x]->DetachFromActor(FDetachmentTransformRules::KeepWorldTransform);
+	//Reset rotation from PieceRotator (no piece is attached to it between two rotations)
+	PieceRotator->SetRelativeRotation(FRotator(0, 0, 0));
+
+	//Set all the pieces of the layers as child of the PieceRotator
+	TArray<int32> layerPieces;
+	for (int32 x = 0; x < numMoves; x++) {
+		TArray<int32> pieces;
+		LogicalState.GetLayerPieces(moves[x].Axis, moves[x].Layer, pieces);
+		layerPieces.Append(pieces);
+	}
+	for (int32 pieceIndex : layerPieces) {
+		if (Pieces.IsValidIndex(pieceIndex)) {
+			PiecesToRotate.Add(Pieces[pieceIndex]);
+			Pieces[pieceIndex]->AttachToComponent(PieceRotator, FAttachmentTransformRules::KeepWorldTransform);
+		}
 	}
 
-	//Reset rotation from PieceRotator
-	PieceRotator->SetRelativeRotation(FRotator(0, 0, 0));
+	UE_LOG(LogActor, Warning, TEXT("%d pieces found."), PiecesToRotate.Num());
 
+	if (bLogicalOnly) {
+		EnableCollisionProxies(layerPieces);
+	}
 
-	//Add all pieces from the same group as the given piece to the PiecesToRotate array (used fabs just to prevent possible minimal erros)
-	if (groupAxis == ERotationGroup::RotationGroup::X) {
-		for (int32 x = 0; x < Pieces.Num(); x++) {
-			if (fabs(this->GetTransform().InverseTransformPosition(Pieces[x]->GetActorLocation()).X -
-				this->GetTransform().InverseTransformPosition(piece->GetActorLocation()).X) < CUBE_ROTATE_THRESHOLD) {
-				PiecesToRotate.Add(Pieces[x]);
-			}
-		}
+	PendingMoves.Reset();
+	PendingMoves.Append(moves, numMoves);
+
+	// start Rotation, every layer turns the same way
+	destRotation = moves[0].ToRotator();
+	isRotating = true;
+
+	if (!RotationManager.IsValid()) {
+		RotationManager = ARubiksCubeManager::Get(GetWorld());
 	}
-	else if (groupAxis == ERotationGroup::RotationGroup::Y) {
-		for (int32 x = 0; x < Pieces.Num(); x++) {
-			if (fabs(this->GetTransform().InverseTransformPosition(Pieces[x]->GetActorLocation()).Y -
-				this->GetTransform().InverseTransformPosition(piece->GetActorLocation()).Y) < CUBE_ROTATE_THRESHOLD) {
-				PiecesToRotate.Add(Pieces[x]);
-			}
+	if (RotationManager.IsValid()) {
+		RotationManager->AddRotation(this, totalRotationTime, destRotation);
+	}
+	else {
+		FinishLayerRotation();
+	}
+}
+
+void ARubiksCube::EnableCollisionProxies(const TArray<int32>& pieceIndices)
+{
+	float cellExtent = CUBE_EXTENT * this->CubeExtentScale;
+
+	//Use the collision profile of the first colliding component of a piece so the proxies block whatever the pieces would block
+	FName profileName = UCollisionProfile::BlockAllDynamic_ProfileName;
+	TArray<UActorComponent*> templates;
+	GetPieceComponentTemplates(templates);
+	for (UActorComponent* component : templates) {
+		UPrimitiveComponent* primitive = Cast<UPrimitiveComponent>(component);
+		if (primitive && primitive->GetCollisionEnabled() != ECollisionEnabled::NoCollision) {
+			profileName = primitive->GetCollisionProfileName();
+			break;
 		}
 	}
-	else if (groupAxis == ERotationGroup::RotationGroup::Z) {
-		for (int32 x = 0; x < Pieces.Num(); x++) {
-			if (fabs(this->GetTransform().InverseTransformPosition(Pieces[x]->GetActorLocation()).Z -
-				this->GetTransform().InverseTransformPosition(piece->GetActorLocation()).Z) < CUBE_ROTATE_THRESHOLD) {
-				PiecesToRotate.Add(Pieces[x]);
-			}
+
+	for (int32 x = 0; x < pieceIndices.Num(); x++) {
+		if (x >= CollisionProxies.Num()) {
+			UBoxComponent* proxy = NewObject<UBoxComponent>(this);
+			proxy->SetBoxExtent(FVector(cellExtent / 2, cellExtent / 2, cellExtent / 2));
+			proxy->SetCollisionProfileName(profileName);
+			proxy->RegisterComponent();
+			proxy->AttachToComponent(PieceRotator, FAttachmentTransformRules::KeepWorldTransform);
+			CollisionProxies.Add(proxy);
 		}
+
+		UBoxComponent* proxy = CollisionProxies[x];
+		proxy->SetWorldTransform(LogicalState.GetPieceTransform(pieceIndices[x], cellExtent) * GetActorTransform());
+		proxy->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
 	}
+}
 
-	for (int32 x = 0; x < Pieces.Num(); x++) {
-		Pieces[x]->AttachToActor(this, FAttachmentTransformRules::KeepWorldTransform);
-		//Pieces[x]->AttachToActor(this, FAttachmentTransformRules::KeepRelativeTransform);
+void ARubiksCube::DisableCollisionProxies()
+{
+	for (int32 x = 0; x < CollisionProxies.Num(); x++) {
+		CollisionProxies[x]->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	}
+}
+
+void ARubiksCube::GetPieceComponentTemplates(TArray<UActorComponent*>& outTemplates) const
+{
+	if (!PieceClass) {
+		return;
 	}
 
+	TInlineComponentArray<UActorComponent*> components;
+	PieceClass->GetDefaultObject<ARubiksPiece>()->GetComponents(components);
+	outTemplates.Append(components);
 
-	//Set all the pieces to rotate as child of the PieceRotator
-	for (int32 x = 0; x < PiecesToRotate.Num(); x++) {
-		PiecesToRotate[x]->AttachToComponent(PieceRotator, FAttachmentTransformRules::KeepWorldTransform);
-		//PiecesToRotate[x]->AttachToComponent(PieceRotator, FAttachmentTransformRules::KeepRelativeTransform);
+	for (UClass* pieceClass = PieceClass; pieceClass; pieceClass = pieceClass->GetSuperClass()) {
+		UBlueprintGeneratedClass* blueprintClass = Cast<UBlueprintGeneratedClass>(pieceClass);
+		if (blueprintClass && blueprintClass->SimpleConstructionScript) {
+			for (USCS_Node* node : blueprintClass->SimpleConstructionScript->GetAllNodes()) {
+				if (node && node->ComponentTemplate) {
+					outTemplates.Add(node->ComponentTemplate);
+				}
+			}
+		}
 	}
+}
 
-	UE_LOG(LogActor, Warning, TEXT("%d pieces found."), PiecesToRotate.Num());
+void ARubiksCube::CommitMove(const FRubiksMove& move)
+{
+	LogicalState.ApplyMove(move);
+	MoveHistory.Push(move, LogicalState);
 
-	// start Rotation
-	destRotation = rotation;
-	isRotating = true;
+	//Only the first move after an input counts the time since the input before
+	RecordTelemetry(ERubiksTelemetryEvent::Move, move, PendingSinceLastInput, 0);
+	PendingSinceLastInput = 0;
+	RecordSolvedTelemetry();
+}
+
+void ARubiksCube::ApplyMoveInstantly(const FRubiksMove& move)
+{
+	LogicalState.ApplyMove(move);
+
+	TArray<int32> movedPieces;
+	LogicalState.GetLayerPieces(move.Axis, move.Layer, movedPieces);
+	SyncPiecesToLogicalState(movedPieces);
+}
+
+void ARubiksCube::SyncPiecesToLogicalState(const TArray<int32>& pieceIndices)
+{
+	float cellExtent = CUBE_EXTENT * this->CubeExtentScale;
+
+	for (int32 pieceIndex : pieceIndices) {
+		if (!Pieces.IsValidIndex(pieceIndex)) {
+			continue;
+		}
+
+		ARubiksPiece* piece = Pieces[pieceIndex];
+		piece->AttachToActor(this, FAttachmentTransformRules::KeepWorldTransform);
+		piece->SetActorRelativeTransform(LogicalState.GetPieceTransform(pieceIndex, cellExtent));
+	}
+}
+
+void ARubiksCube::SyncAllPiecesToLogicalState()
+{
+	TArray<int32> allPieces;
+	LogicalState.GetLayerPieces(ERotationGroup::X, INDEX_NONE, allPieces);
+	SyncPiecesToLogicalState(allPieces);
 }
 
 
@@ -378,73 +579,41 @@ TArray <class ARubiksPiece*>  ARubiksCube::TargetPiecesToRotateGroup(FVector nor
 		return PotentialPiecesToRotateGroup;
 	}
 
-	ERotationGroup::RotationGroup potentialRotationGroup;
-
-	if (normal.Equals(FVector(0, 0, 1))) { //Top Face
-		UE_LOG(LogActor, Warning, TEXT("Top face!"));
-		
-		potentialRotationGroup = ERotationGroup::RotationGroup::Z;
-	}
-	else if (normal.Equals(FVector(0, 0, -1))) { //Bottom Face
-		UE_LOG(LogActor, Warning, TEXT("Bottom face!"));
-
-		potentialRotationGroup = ERotationGroup::RotationGroup::Z;
-
+	TArray<int32> pieceIDs = TargetPieceIDsToRotateGroup(normal, piece->cubePieceID);
+	for (int32 pieceID : pieceIDs) {
+		if (Pieces.IsValidIndex(pieceID - 1)) {
+			PotentialPiecesToRotateGroup.Add(Pieces[pieceID - 1]);
+		}
 	}
-	else if (normal.Equals(FVector(1, 0, 0))) { //Back face
-		UE_LOG(LogActor, Warning, TEXT("Back face!"));
-
-		potentialRotationGroup = ERotationGroup::RotationGroup::X;
 
-	}
-	else if (normal.Equals(FVector(-1, 0, 0))) { //Front Face
-		UE_LOG(LogActor, Warning, TEXT("Front face!"));
-
-		potentialRotationGroup = ERotationGroup::RotationGroup::X;
+	return PotentialPiecesToRotateGroup;
+}
 
-	}
-	else if (normal.Equals(FVector(0, -1, 0))) { //Right Face
-		UE_LOG(LogActor, Warning, TEXT("Right face!"));
 
-		potentialRotationGroup = ERotationGroup::RotationGroup::Y;
+TArray<int32> ARubiksCube::TargetPieceIDsToRotateGroup(FVector normal, int32 pieceID) {
+	TArray<int32> pieceIDs;
 
+	if (pieceID < 1 || pieceID > LogicalState.GetNumPieces()) {
+		UE_LOG(LogActor, Warning, TEXT("input piece is not part of this cube!"));
+		return pieceIDs;
 	}
-	else if (normal.Equals(FVector(0, 1, 0))) { //Left Face
-		UE_LOG(LogActor, Warning, TEXT("Left face!"));
-
-		potentialRotationGroup = ERotationGroup::RotationGroup::Y;
 
+	ERotationGroup::RotationGroup groupAxis;
+	FRotator rotation;
+	if (GetFaceRotation(normal, true, groupAxis, rotation) == -1) {
+		return pieceIDs;
 	}
 
+	//Add all pieces from the same group as the given piece
+	FIntVector cell = LogicalState.GetCellCoordinates(LogicalState.GetPieceCell(pieceID - 1));
 
-	//Add all pieces from the same group as the given piece to the PiecesToRotate array (used fabs just to prevent possible minimal erros)
-	if (potentialRotationGroup == ERotationGroup::RotationGroup::X) {
-		for (int32 x = 0; x < Pieces.Num(); x++) {
-			if (fabs(this->GetTransform().InverseTransformPosition(Pieces[x]->GetActorLocation()).X -
-				this->GetTransform().InverseTransformPosition(piece->GetActorLocation()).X) < CUBE_ROTATE_THRESHOLD) {
-				PotentialPiecesToRotateGroup.Add(Pieces[x]);
-			}
-		}
-	}
-	else if (potentialRotationGroup == ERotationGroup::RotationGroup::Y) {
-		for (int32 x = 0; x < Pieces.Num(); x++) {
-			if (fabs(this->GetTransform().InverseTransformPosition(Pieces[x]->GetActorLocation()).Y -
-				this->GetTransform().InverseTransformPosition(piece->GetActorLocation()).Y) < CUBE_ROTATE_THRESHOLD) {
-				PotentialPiecesToRotateGroup.Add(Pieces[x]);
-			}
-		}
+	TArray<int32> layerPieces;
+	LogicalState.GetLayerPieces(groupAxis, cell[groupAxis], layerPieces);
+	for (int32 pieceIndex : layerPieces) {
+		pieceIDs.Add(pieceIndex + 1);
 	}
 
-	else if (potentialRotationGroup == ERotationGroup::RotationGroup::Z) {
-		for (int32 x = 0; x < Pieces.Num(); x++) {
-			if (fabs(this->GetTransform().InverseTransformPosition(Pieces[x]->GetActorLocation()).Z -
-				this->GetTransform().InverseTransformPosition(piece->GetActorLocation()).Z) < CUBE_ROTATE_THRESHOLD) {
-				PotentialPiecesToRotateGroup.Add(Pieces[x]);
-			}
-		}
-	}
-
-	return PotentialPiecesToRotateGroup;
+	return pieceIDs;
 }
 
 void ARubiksCube::RotateWholeCube(ERotationGroup::RotationGroup directionGroup, int clockWise)  {
@@ -453,10 +622,14 @@ void ARubiksCube::RotateWholeCube(ERotationGroup::RotationGroup directionGroup,
 		return;
 	}
 
+	float sinceLastInput = NoteInput();
+
 	//Don't rotate the whole cube while one face is rotating
 	if (this->isRotating) {
+		RecordTelemetry(ERubiksTelemetryEvent::RejectedInput, FRubiksMove(directionGroup, INDEX_NONE, 0), sinceLastInput, INDEX_NONE);
 		return;
 	}
+	PendingSinceLastInput = sinceLastInput;
 
 	//Remove parent from all pieces
 	for (int32 x = 0; x < Pieces.Num(); x++) {
@@ -504,6 +677,19 @@ void ARubiksCube::RotateWholeCube(ERotationGroup::RotationGroup directionGroup,
 		default:
 			break;
 	}
+
+	//SelfRotator pitches for X, yaws for Y and rolls for Z
+	ERotationGroup::RotationGroup turnAxis = ERotationGroup::Y;
+	if (directionGroup == ERotationGroup::Y) {
+		turnAxis = ERotationGroup::Z;
+	}
+	else if (directionGroup == ERotationGroup::Z) {
+		turnAxis = ERotationGroup::X;
+	}
+	CommitMove(FRubiksMove(turnAxis, INDEX_NONE, clockWise == 1 ? 1 : -1));
+
+	//Put every piece back on the cube so the next rotation starts from a clean hierarchy
+	SyncAllPiecesToLogicalState();
 }
 
 
@@ -511,140 +697,403 @@ void ARubiksCube::RotateWholeCube(ERotationGroup::RotationGroup directionGroup,
 
 
 int32 ARubiksCube::RotateFromPieceClockwiseWithCollisionDetection(FVector normal, class ARubiksPiece * piece) {
-	if (this->isRotating) {
-		return -1;
+	return RotateFromPieceIDInternal(normal, piece ? piece->cubePieceID : INDEX_NONE, true, true);
+}
+
+
+int32 ARubiksCube::RotateFromPieceIDClockwiseWithCollisionDetection(FVector normal, int32 pieceID) {
+	return RotateFromPieceIDInternal(normal, pieceID, true, true);
+}
+
+
+int32 ARubiksCube::RotateFromPieceCounterClockwiseWithCollisionDetection(FVector normal, class ARubiksPiece * piece) {
+	return RotateFromPieceIDInternal(normal, piece ? piece->cubePieceID : INDEX_NONE, false, true);
+}
+
+
+int32 ARubiksCube::RotateFromPieceIDCounterClockwiseWithCollisionDetection(FVector normal, int32 pieceID) {
+	return RotateFromPieceIDInternal(normal, pieceID, false, true);
+}
+
+
+void ARubiksCube::RotateFromPieceDoRotation() {
+	if (potentialPieceID == INDEX_NONE) {
+		UE_LOG(LogActor, Warning, TEXT("Potential Rotation piece is NULL"));
+		return;
 	}
 
-	UE_LOG(LogActor, Warning, TEXT("Rotate From Piece Clockwise!"));
-	if (normal.Equals(FVector(0, 0, 1))) { //Top Face
-		UE_LOG(LogActor, Warning, TEXT("Top face!"));
+	RotateGroup(FName("Group Rotation"), potentialPieceID, potentialRotationGroup, potentialRotator);
+}
 
-		potentialRotationGroup = ERotationGroup::RotationGroup::Z;
-		potentialPiece = piece;
-		potentialRotator = FRotator(0, 90, 0);
 
-		return 1;
+bool ARubiksCube::UndoMove() {
+	float sinceLastInput = NoteInput();
+	if (this->isRotating) {
+		RecordTelemetry(ERubiksTelemetryEvent::RejectedInput, FRubiksMove(ERotationGroup::X, INDEX_NONE, 0), sinceLastInput, INDEX_NONE);
+		return false;
 	}
-	else if (normal.Equals(FVector(0, 0, -1))) { //Bottom Face
-		UE_LOG(LogActor, Warning, TEXT("Bottom face!"));
 
-		potentialRotationGroup = ERotationGroup::RotationGroup::Z;
-		potentialPiece = piece;
-		potentialRotator = FRotator(0, -90, 0);
+	FRubiksMove move;
+	if (!MoveHistory.Undo(move)) {
+		return false;
+	}
+
+	ApplyMoveInstantly(move);
+	RecordTelemetry(ERubiksTelemetryEvent::Undo, move, sinceLastInput, 0);
+	RecordSolvedTelemetry();
+	return true;
+}
 
-		return 2;
+bool ARubiksCube::RedoMove() {
+	float sinceLastInput = NoteInput();
+	if (this->isRotating) {
+		RecordTelemetry(ERubiksTelemetryEvent::RejectedInput, FRubiksMove(ERotationGroup::X, INDEX_NONE, 0), sinceLastInput, INDEX_NONE);
+		return false;
 	}
-	else if (normal.Equals(FVector(1, 0, 0))) { //Back face
-		UE_LOG(LogActor, Warning, TEXT("Back face!"));
 
-		potentialRotationGroup = ERotationGroup::RotationGroup::X;
-		potentialPiece = piece;
-		potentialRotator = FRotator(0, 0, -90);
+	FRubiksMove move;
+	if (!MoveHistory.Redo(move)) {
+		return false;
+	}
 
-		return 3;
+	ApplyMoveInstantly(move);
+	RecordTelemetry(ERubiksTelemetryEvent::Redo, move, sinceLastInput, 0);
+	RecordSolvedTelemetry();
+	return true;
+}
+
+bool ARubiksCube::RewindToMove(int32 moveIndex) {
+	if (this->isRotating) {
+		return false;
 	}
-	else if (normal.Equals(FVector(-1, 0, 0))) { //Front Face
-		UE_LOG(LogActor, Warning, TEXT("Front face!"));
 
-		potentialRotationGroup = ERotationGroup::RotationGroup::X;
-		potentialPiece = piece;
-		potentialRotator = FRotator(0, 0, 90);
+	if (!MoveHistory.Seek(moveIndex, LogicalState)) {
+		UE_LOG(LogActor, Warning, TEXT("move %d is not in the history!"), moveIndex);
+		return false;
+	}
+
+	SyncAllPiecesToLogicalState();
+	RecordSolvedTelemetry();
+	return true;
+}
+
+int32 ARubiksCube::GetCurrentMoveIndex() const {
+	return MoveHistory.GetCurrentIndex();
+}
+
+void ARubiksCube::GetMoveHistoryRange(int32& firstIndex, int32& lastIndex) const {
+	firstIndex = MoveHistory.GetFirstIndex();
+	lastIndex = MoveHistory.GetLastIndex();
+}
+
 
-		return 4;
+FString ARubiksCube::GetStateHash() const {
+	return FString::Printf(TEXT("%016llx"), LogicalState.GetHash());
+}
+
+bool ARubiksCube::GetHint(int32 maxSearchDepth, FRubiksMove& nextMove, int32& movesToSolved) {
+	FRubiksHintSolver solver(FRubiksTranspositionCache::Get());
+	return solver.FindCachedHint(LogicalState, maxSearchDepth, nextMove, movesToSolved);
+}
+
+bool ARubiksCube::SaveHintCache() {
+	return FRubiksTranspositionCache::Get().SaveToFile(FRubiksTranspositionCache::GetDefaultFilename());
+}
+
+int32 ARubiksCube::GetOptimalMovesToSolved() {
+	if (this->CubeSize != 2) {
+		return -1;
 	}
-	else if (normal.Equals(FVector(0, -1, 0))) { //Right Face
-		UE_LOG(LogActor, Warning, TEXT("Right face!"));
 
-		potentialRotationGroup = ERotationGroup::RotationGroup::Y;
-		potentialPiece = piece;
-		potentialRotator = FRotator(90, 0, 0);
+	return FRubiks2x2DistanceTable::Get().GetDistance(LogicalState);
+}
 
-		return 5;
+bool ARubiksCube::GetOptimalMove(FRubiksMove& nextMove, int32& movesToSolved) {
+	if (this->CubeSize != 2) {
+		UE_LOG(LogActor, Warning, TEXT("the distance table only covers the 2x2x2 cube!"));
+		movesToSolved = -1;
+		return false;
 	}
-	else if (normal.Equals(FVector(0, 1, 0))) { //Left Face
-		UE_LOG(LogActor, Warning, TEXT("Left face!"));
 
-		potentialRotationGroup = ERotationGroup::RotationGroup::Y;
-		potentialPiece = piece;
-		potentialRotator = FRotator(-90, 0, 0);
+	return FRubiks2x2DistanceTable::Get().GetOptimalMove(LogicalState, nextMove, movesToSolved);
+}
+
 
-		return 6;
+bool ARubiksCube::IsLogicalOnly() const {
+	return bLogicalOnly;
+}
+
+FTransform ARubiksCube::GetPieceTransformByID(int32 pieceID) {
+	if (pieceID < 1 || pieceID > LogicalState.GetNumPieces()) {
+		UE_LOG(LogActor, Warning, TEXT("input piece is not part of this cube!"));
+		return GetActorTransform();
 	}
 
-	return -1;
+	return LogicalState.GetPieceTransform(pieceID - 1, CUBE_EXTENT * this->CubeExtentScale) * GetActorTransform();
 }
 
+FString ARubiksCube::GetMemoryReport() {
+	int32 numPieces = LogicalState.GetNumPieces();
+	SIZE_T logicalBytes = sizeof(FRubiksCubeState) + LogicalState.GetAllocatedSize() + MoveHistory.GetAllocatedSize();
 
-int32 ARubiksCube::RotateFromPieceCounterClockwiseWithCollisionDetection(FVector normal, class ARubiksPiece * piece) {
-	if (this->isRotating) {
-		return -1;
+	//Object memory of an actor and its components, render and physics resources are shared or not counted
+	auto GetActorBytes = [](const AActor* actor)
+	{
+		SIZE_T bytes = actor->GetClass()->GetStructureSize();
+		TInlineComponentArray<UActorComponent*> components;
+		actor->GetComponents(components);
+		for (UActorComponent* component : components) {
+			bytes += component->GetClass()->GetStructureSize();
+		}
+		return bytes;
+	};
+
+	SIZE_T pieceBytes = 0;
+	for (int32 x = 0; x < Pieces.Num(); x++) {
+		pieceBytes += GetActorBytes(Pieces[x]);
 	}
 
-	UE_LOG(LogActor, Warning, TEXT("Rotate From Piece Clockwise!"));
-	if (normal.Equals(FVector(0, 0, 1))) { //Top Face
-		UE_LOG(LogActor, Warning, TEXT("Top face!"));
+	SIZE_T proxyBytes = 0;
+	for (int32 x = 0; x < CollisionProxies.Num(); x++) {
+		proxyBytes += CollisionProxies[x]->GetClass()->GetStructureSize();
+	}
 
-		potentialRotationGroup = ERotationGroup::RotationGroup::Z;
-		potentialPiece = piece;
-		potentialRotator = FRotator(0, -90, 0);
+	FString report = FString::Printf(TEXT("%s: %dx%dx%d, %d pieces, %s mode\n"), *GetName(), this->CubeSize, this->CubeSize, this->CubeSize, numPieces, bLogicalOnly ? TEXT("logical only") : TEXT("full"));
+	report += FString::Printf(TEXT("  logical state and history: %d bytes\n"), (int32)logicalBytes);
+	report += FString::Printf(TEXT("  piece actors: %d (%d bytes)\n"), Pieces.Num(), (int32)pieceBytes);
+	report += FString::Printf(TEXT("  collision proxies: %d (%d bytes)\n"), CollisionProxies.Num(), (int32)proxyBytes);
+
+	if (bLogicalOnly && PieceClass) {
+		//What each piece actor would have cost: the actor and every component it gets, construction script ones included
+		SIZE_T bytesPerPiece = PieceClass->GetStructureSize();
+		TArray<UActorComponent*> templates;
+		GetPieceComponentTemplates(templates);
+		for (UActorComponent* component : templates) {
+			bytesPerPiece += component->GetClass()->GetStructureSize();
+		}
 
-		return 1;
+		//Signed, the proxies of a layer can outweigh a tiny piece class
+		int64 savedBytes = (int64)(bytesPerPiece * numPieces) - (int64)proxyBytes;
+		report += FString::Printf(TEXT("  saved versus piece actors: about %lld bytes\n"), FMath::Max<int64>(savedBytes, 0));
 	}
-	else if (normal.Equals(FVector(0, 0, -1))) { //Bottom Face
-		UE_LOG(LogActor, Warning, TEXT("Bottom face!"));
 
-		potentialRotationGroup = ERotationGroup::RotationGroup::Z;
-		potentialPiece = piece;
-		potentialRotator = FRotator(0, 90, 0);
+	UE_LOG(LogActor, Log, TEXT("%s"), *report);
+	return report;
+}
+
+
+int32 ARubiksCube::GetDroppedTelemetryRecords() const {
+	//Don't start the telemetry writer thread just to ask
+	return this->bRecordTelemetry ? FRubiksTelemetry::Get().GetNumDropped() : 0;
+}
+
 
-		return 2;
+bool ARubiksCube::PickPiece(FVector rayOrigin, FVector rayDirection, FRubiksPickResult& result) {
+	int32 size = LogicalState.GetSize();
+	if (this->isRotating || size == 0) {
+		return false;
 	}
-	else if (normal.Equals(FVector(1, 0, 0))) { //Back face
-		UE_LOG(LogActor, Warning, TEXT("Back face!"));
 
-		potentialRotationGroup = ERotationGroup::RotationGroup::X;
-		potentialPiece = piece;
-		potentialRotator = FRotator(0, 0, 90);
+	//Work in cell units: cell (i, j, k) covers [i, i + 1) x [j, j + 1) x [k, k + 1) and the cube covers [0, size)
+	const FTransform& cubeTransform = GetActorTransform();
+	float cellExtent = CUBE_EXTENT * this->CubeExtentScale;
+	FVector origin = cubeTransform.InverseTransformPosition(rayOrigin) / cellExtent + FVector(0.5f, 0.5f, 0.5f);
+	FVector direction = cubeTransform.InverseTransformVector(rayDirection) / cellExtent;
+
+	//Clip the ray against the cube's bounds, enterAxis stays -1 if the ray starts inside
+	float enterDistance = 0.0f;
+	float exitDistance = BIG_NUMBER;
+	int32 enterAxis = -1;
+	for (int32 axis = 0; axis < 3; axis++) {
+		if (FMath::IsNearlyZero(direction[axis])) {
+			if (origin[axis] < 0 || origin[axis] >= size) {
+				return false;
+			}
+			continue;
+		}
 
-		return 3;
+		float nearDistance = (0 - origin[axis]) / direction[axis];
+		float farDistance = (size - origin[axis]) / direction[axis];
+		if (nearDistance > farDistance) {
+			Swap(nearDistance, farDistance);
+		}
+		if (nearDistance > enterDistance) {
+			enterDistance = nearDistance;
+			enterAxis = axis;
+		}
+		exitDistance = FMath::Min(exitDistance, farDistance);
 	}
-	else if (normal.Equals(FVector(-1, 0, 0))) { //Front Face
-		UE_LOG(LogActor, Warning, TEXT("Front face!"));
+	if (enterDistance > exitDistance) {
+		return false;
+	}
+
+	//Walk the cells along the ray (Amanatides & Woo)
+	FVector start = origin + direction * enterDistance;
+	FIntVector cell;
+	FIntVector step;
+	FVector nextCrossing;
+	FVector crossingDelta;
+	for (int32 axis = 0; axis < 3; axis++) {
+		cell[axis] = FMath::Clamp(FMath::FloorToInt(start[axis]), 0, size - 1);
+		step[axis] = FMath::IsNearlyZero(direction[axis]) ? 0 : (direction[axis] > 0 ? 1 : -1);
+		nextCrossing[axis] = step[axis] == 0 ? BIG_NUMBER : (cell[axis] + (step[axis] > 0 ? 1 : 0) - origin[axis]) / direction[axis];
+		crossingDelta[axis] = step[axis] == 0 ? BIG_NUMBER : FMath::Abs(1.0f / direction[axis]);
+	}
+
+	int32 hitAxis = enterAxis;
+	float hitDistance = enterDistance;
+	while (true) {
+		int32 nextAxis = nextCrossing.X < nextCrossing.Y ? (nextCrossing.X < nextCrossing.Z ? 0 : 2) : (nextCrossing.Y < nextCrossing.Z ? 1 : 2);
+
+		int32 pieceIndex = LogicalState.GetPieceInCell(LogicalState.GetCellIndex(cell));
+		if (pieceIndex != INDEX_NONE) {
+			//Starting inside a piece, report the wall of that piece the ray reaches, like a trace from inside would
+			if (hitAxis == -1) {
+				hitAxis = nextAxis;
+				hitDistance = nextCrossing[nextAxis];
+			}
+
+			FVector localNormal(0, 0, 0);
+			localNormal[hitAxis] = -step[hitAxis];
+
+			result.PieceID = pieceIndex + 1;
+			result.Piece = Pieces.IsValidIndex(pieceIndex) ? Pieces[pieceIndex] : NULL;
+			result.LocalNormal = localNormal;
+			result.WorldNormal = cubeTransform.TransformVectorNoScale(localNormal);
+			result.Axis = (ERotationGroup::RotationGroup)hitAxis;
+			result.Layer = cell[hitAxis];
+			result.HitLocation = rayOrigin + rayDirection * hitDistance;
+			result.Distance = hitDistance * rayDirection.Size();
+
+			//Same face numbering as GetFaceRotation
+			static const int32 faces[3][2] = { { 4, 3 }, { 5, 6 }, { 2, 1 } };
+			result.Face = faces[hitAxis][localNormal[hitAxis] > 0 ? 1 : 0];
+			return true;
+		}
+
+		//Step into the next cell, inner cells of bigger cubes are empty
+		if (nextCrossing[nextAxis] > exitDistance) {
+			return false;
+		}
+		cell[nextAxis] += step[nextAxis];
+		if (cell[nextAxis] < 0 || cell[nextAxis] >= size) {
+			return false;
+		}
+		hitAxis = nextAxis;
+		hitDistance = nextCrossing[nextAxis];
+		nextCrossing[nextAxis] += crossingDelta[nextAxis];
+	}
+}
 
-		potentialRotationGroup = ERotationGroup::RotationGroup::X;
-		potentialPiece = piece;
-		potentialRotator = FRotator(0, 0, -90);
 
-		return 4;
+bool ARubiksCube::ApplyAlgorithm(const FString& notation) {
+	if (this->isRotating) {
+		return false;
 	}
-	else if (normal.Equals(FVector(0, -1, 0))) { //Right Face
-		UE_LOG(LogActor, Warning, TEXT("Right face!"));
 
-		potentialRotationGroup = ERotationGroup::RotationGroup::Y;
-		potentialPiece = piece;
-		potentialRotator = FRotator(-90, 0, 0);
+	FString error;
+	FRubiksAlgorithmPtr algorithm = FRubiksAlgorithm::FindOrCompile(notation, LogicalState.GetSize(), error);
+	if (!algorithm.IsValid()) {
+		UE_LOG(LogActor, Warning, TEXT("invalid algorithm \"%s\": %s"), *notation, *error);
+		return false;
+	}
+
+	FRubiksCubeState stateBefore = LogicalState;
+	algorithm->Apply(LogicalState);
+	MoveHistory.PushMoves(algorithm->GetMoves(), stateBefore);
+	SyncAllPiecesToLogicalState();
+
+	RecordTelemetry(ERubiksTelemetryEvent::Algorithm, FRubiksMove(ERotationGroup::X, INDEX_NONE, 0), 0, algorithm->GetMoves().Num());
+	RecordSolvedTelemetry();
+	return true;
+}
 
-		return 5;
+bool ARubiksCube::PlayAlgorithm(const FString& notation) {
+	if (this->isRotating) {
+		return false;
 	}
-	else if (normal.Equals(FVector(0, 1, 0))) { //Left Face
-		UE_LOG(LogActor, Warning, TEXT("Left face!"));
 
-		potentialRotationGroup = ERotationGroup::RotationGroup::Y;
-		potentialPiece = piece;
-		potentialRotator = FRotator(90, 0, 0);
+	FString error;
+	FRubiksAlgorithmPtr algorithm = FRubiksAlgorithm::FindOrCompile(notation, LogicalState.GetSize(), error);
+	if (!algorithm.IsValid()) {
+		UE_LOG(LogActor, Warning, TEXT("invalid algorithm \"%s\": %s"), *notation, *error);
+		return false;
+	}
 
-		return 6;
+	PlayingAlgorithm = algorithm;
+	PlayingStep = 0;
+	PlayNextAlgorithmStep();
+	return true;
+}
+
+void ARubiksCube::PlayNextAlgorithmStep() {
+	if (PlayingStep >= PlayingAlgorithm->GetNumSteps()) {
+		PlayingAlgorithm.Reset();
+		return;
 	}
 
-	return -1;
+	int32 firstMove;
+	int32 numMoves;
+	PlayingAlgorithm->GetStep(PlayingStep++, firstMove, numMoves);
+
+	//Keep the algorithm alive, the rotation may finish (and clear it) before this returns
+	FRubiksAlgorithmPtr algorithm = PlayingAlgorithm;
+	BeginLayerRotation(&algorithm->GetMoves()[firstMove], numMoves);
 }
 
+void ARubiksCube::StopAlgorithm() {
+	PlayingAlgorithm.Reset();
+}
 
-void ARubiksCube::RotateFromPieceDoRotation() {
-	if (potentialPiece == NULL) {
-		UE_LOG(LogActor, Warning, TEXT("Potential Rotation piece is NULL"));
+bool ARubiksCube::IsPlayingAlgorithm() const {
+	return PlayingAlgorithm.IsValid();
+}
+
+bool ARubiksCube::IsValidAlgorithm(const FString& notation, int32 cubeSize, FString& error) {
+	error.Empty();
+
+	//Only parsed, so checking what a player types doesn't fill the algorithm cache
+	TArray<FRubiksMove> moves;
+	TArray<int32> stepStarts;
+	return FRubiksAlgorithm::Parse(notation, cubeSize, moves, stepStarts, error);
+}
+
+
+float ARubiksCube::NoteInput() {
+	double now = FPlatformTime::Seconds();
+	float sinceLastInput = LastInputTime > 0 ? (float)(now - LastInputTime) : 0.0f;
+	LastInputTime = now;
+	return sinceLastInput;
+}
+
+void ARubiksCube::RecordTelemetry(ERubiksTelemetryEvent::Type type, const FRubiksMove& move, float sinceLastInput, int32 value) {
+	if (!this->bRecordTelemetry) {
 		return;
 	}
 
-	RotateGroup(FName("Group Rotation"), potentialPiece, potentialRotationGroup, potentialRotator);
-}
\ No newline at end of file
+	FRubiksTelemetryRecord record;
+	record.Cycles = FPlatformTime::Cycles64();
+	record.CubeID = GetUniqueID();
+	record.SinceLastInput = sinceLastInput;
+	record.MoveIndex = MoveHistory.GetCurrentIndex();
+	record.Layer = move.Layer;
+	record.Type = type;
+	record.Axis = move.Axis;
+	record.QuarterTurns = (int8)move.QuarterTurns;
+	record.Reserved = 0;
+	record.Value = value;
+
+	FRubiksTelemetry::Get().Push(record);
+}
+
+void ARubiksCube::RecordSolvedTelemetry() {
+	if (!this->bRecordTelemetry) {
+		return;
+	}
+
+	bool solved = LogicalState.IsSolvedInAnyOrientation();
+	if (solved && !bWasSolved) {
+		RecordTelemetry(ERubiksTelemetryEvent::Solved, FRubiksMove(ERotationGroup::X, INDEX_NONE, 0), 0, 0);
+	}
+	bWasSolved = solved;
+}
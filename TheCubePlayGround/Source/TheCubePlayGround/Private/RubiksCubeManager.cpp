@@ -0,0 +1,115 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RubiksCubeManager.h"
+#include "TheCubePlayGround.h"
+#include "RubiksCube.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "Async/ParallelFor.h"
+
+
+ARubiksCubeManager::ARubiksCubeManager()
+{
+	//Only ticks while at least one cube is rotating
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+
+	ParallelRotationThreshold = 64;
+}
+
+ARubiksCubeManager* ARubiksCubeManager::Get(UWorld* world)
+{
+	if (world == NULL) {
+		return NULL;
+	}
+
+	for (TActorIterator<ARubiksCubeManager> it(world); it; ++it) {
+		return *it;
+	}
+
+	FActorSpawnParameters params;
+	params.ObjectFlags |= RF_Transient;
+	return world->SpawnActor<ARubiksCubeManager>(params);
+}
+
+void ARubiksCubeManager::AddRotation(ARubiksCube* cube, float totalRotationTime, FRotator destRotation)
+{
+	Cubes.Add(cube);
+	PassRotationTimes.Add(0.0f);
+	TotalRotationTimes.Add(totalRotationTime);
+	DestRotations.Add(destRotation);
+	FrameRotations.Add(FQuat::Identity);
+
+	SetActorTickEnabled(true);
+}
+
+void ARubiksCubeManager::RemoveRotation(ARubiksCube* cube)
+{
+	int32 index = Cubes.Find(cube);
+	if (index != INDEX_NONE) {
+		RemoveRotationAt(index);
+	}
+}
+
+void ARubiksCubeManager::RemoveRotationAt(int32 index)
+{
+	Cubes.RemoveAtSwap(index, 1, false);
+	PassRotationTimes.RemoveAtSwap(index, 1, false);
+	TotalRotationTimes.RemoveAtSwap(index, 1, false);
+	DestRotations.RemoveAtSwap(index, 1, false);
+	FrameRotations.RemoveAtSwap(index, 1, false);
+
+	if (Cubes.Num() == 0) {
+		SetActorTickEnabled(false);
+	}
+}
+
+// Called every frame
+void ARubiksCubeManager::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	int32 numRotations = Cubes.Num();
+
+	//Advance every rotation, same easing as the cubes used to do in their own Tick
+	auto AdvanceRotation = [this, DeltaTime](int32 x)
+	{
+		PassRotationTimes[x] += DeltaTime;
+
+		float portionRotate = PassRotationTimes[x] / TotalRotationTimes[x];
+		portionRotate = FMath::Clamp(portionRotate, 0.0f, 1.0f);
+
+		FrameRotations[x] = (portionRotate * DestRotations[x]).Quaternion();
+	};
+
+	if (numRotations >= ParallelRotationThreshold) {
+		ParallelFor(numRotations, AdvanceRotation);
+	}
+	else {
+		for (int32 x = 0; x < numRotations; x++) {
+			AdvanceRotation(x);
+		}
+	}
+
+	//Components can only be moved from the game thread
+	TArray<ARubiksCube*, TInlineAllocator<16>> finishedCubes;
+	for (int32 x = numRotations - 1; x >= 0; x--) {
+		ARubiksCube* cube = Cubes[x];
+		if (cube == NULL || cube->IsPendingKill()) {
+			RemoveRotationAt(x);
+			continue;
+		}
+
+		cube->PieceRotator->SetRelativeRotation(FrameRotations[x]);
+
+		if (PassRotationTimes[x] > TotalRotationTimes[x]) {
+			finishedCubes.Add(cube);
+			RemoveRotationAt(x);
+		}
+	}
+
+	//Finish once the arrays are consistent again, a cube may start its next rotation right away
+	for (ARubiksCube* cube : finishedCubes) {
+		cube->FinishLayerRotation();
+	}
+}
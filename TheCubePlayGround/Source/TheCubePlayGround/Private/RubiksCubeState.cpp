@@ -0,0 +1,392 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RubiksCubeState.h"
+#include "TheCubePlayGround.h"
+#include "Misc/ScopeLock.h"
+
+namespace
+{
+	//The 24 rotations of a cube as signed permutation matrices.
+	//Rows[o][i] is where rotation o sends the basis axis i, the same convention FRotationMatrix uses.
+	struct FOrientationTable
+	{
+		FIntVector Rows[24][3];
+		uint8 Compose[24][24];
+		uint8 Inverse[24];
+		uint8 QuarterTurn[3];
+		FQuat Quats[24];
+
+		FOrientationTable()
+		{
+			//Enumerate every signed permutation with determinant +1, identity first
+			static const int32 permutations[6][3] = { { 0, 1, 2 }, { 1, 2, 0 }, { 2, 0, 1 }, { 0, 2, 1 }, { 2, 1, 0 }, { 1, 0, 2 } };
+			int32 count = 0;
+			for (int32 p = 0; p < 6; p++) {
+				int32 parity = p < 3 ? 1 : -1;
+				for (int32 signs = 0; signs < 8; signs++) {
+					int32 sign[3] = { (signs & 1) ? -1 : 1, (signs & 2) ? -1 : 1, (signs & 4) ? -1 : 1 };
+					if (parity * sign[0] * sign[1] * sign[2] != 1) {
+						continue;
+					}
+					for (int32 i = 0; i < 3; i++) {
+						FIntVector row(0, 0, 0);
+						row[permutations[p][i]] = sign[i];
+						Rows[count][i] = row;
+					}
+					count++;
+				}
+			}
+			check(count == 24);
+
+			for (int32 outer = 0; outer < 24; outer++) {
+				for (int32 inner = 0; inner < 24; inner++) {
+					FIntVector composed[3];
+					for (int32 i = 0; i < 3; i++) {
+						composed[i] = Rotate(outer, Rows[inner][i]);
+					}
+					Compose[outer][inner] = Find(composed);
+				}
+			}
+
+			for (int32 o = 0; o < 24; o++) {
+				for (int32 candidate = 0; candidate < 24; candidate++) {
+					if (Compose[o][candidate] == 0) {
+						Inverse[o] = candidate;
+						break;
+					}
+				}
+
+				FMatrix matrix(FVector(Rows[o][0]), FVector(Rows[o][1]), FVector(Rows[o][2]), FVector::ZeroVector);
+				Quats[o] = FQuat(matrix);
+			}
+
+			//+90 degree Roll, Pitch and Yaw (see FRotationMatrix)
+			FIntVector roll[3] = { FIntVector(1, 0, 0), FIntVector(0, 0, -1), FIntVector(0, 1, 0) };
+			FIntVector pitch[3] = { FIntVector(0, 0, 1), FIntVector(0, 1, 0), FIntVector(-1, 0, 0) };
+			FIntVector yaw[3] = { FIntVector(0, 1, 0), FIntVector(-1, 0, 0), FIntVector(0, 0, 1) };
+			QuarterTurn[ERotationGroup::X] = Find(roll);
+			QuarterTurn[ERotationGroup::Y] = Find(pitch);
+			QuarterTurn[ERotationGroup::Z] = Find(yaw);
+		}
+
+		FIntVector Rotate(int32 orientation, const FIntVector& vector) const
+		{
+			return Rows[orientation][0] * vector.X + Rows[orientation][1] * vector.Y + Rows[orientation][2] * vector.Z;
+		}
+
+		uint8 Find(const FIntVector rows[3]) const
+		{
+			for (int32 o = 0; o < 24; o++) {
+				if (Rows[o][0] == rows[0] && Rows[o][1] == rows[1] && Rows[o][2] == rows[2]) {
+					return (uint8)o;
+				}
+			}
+			check(false);
+			return 0;
+		}
+	};
+
+	const FOrientationTable& GetOrientationTable()
+	{
+		static const FOrientationTable Table;
+		return Table;
+	}
+}
+
+
+FRotator FRubiksMove::ToRotator() const
+{
+	float angle = 90.0f * QuarterTurns;
+	switch (Axis)
+	{
+	case ERotationGroup::X:
+		return FRotator(0, 0, angle);
+	case ERotationGroup::Y:
+		return FRotator(angle, 0, 0);
+	case ERotationGroup::Z:
+		return FRotator(0, angle, 0);
+	default:
+		return FRotator(0, 0, 0);
+	}
+}
+
+
+const FRubiksCubeLayout& FRubiksCubeLayout::Get(int32 size)
+{
+	static FCriticalSection LayoutsLock;
+	static TMap<int32, FRubiksCubeLayout*> Layouts;
+
+	FScopeLock lock(&LayoutsLock);
+
+	FRubiksCubeLayout** found = Layouts.Find(size);
+	if (found) {
+		return **found;
+	}
+
+	FRubiksCubeLayout* layout = new FRubiksCubeLayout();
+	layout->Size = size;
+	layout->HomePieces.Init(INDEX_NONE, size * size * size);
+
+	//Same loop order as ARubiksCube::BuildCube (i is Y, j is X, k is Z)
+	for (int32 i = 0; i < size; i++) {
+		for (int32 j = 0; j < size; j++) {
+			for (int32 k = 0; k < size; k++) {
+				if (i == 0 || i == size - 1 || j == 0 || j == size - 1 || k == 0 || k == size - 1) {
+					int32 cell = j + i * size + k * size * size;
+					layout->HomePieces[cell] = layout->HomeCells.Num();
+					layout->HomeCells.Add(cell);
+				}
+			}
+		}
+	}
+
+	Layouts.Add(size, layout);
+	return *layout;
+}
+
+
+FRubiksCubeState::FRubiksCubeState()
+	: Layout(NULL), Hash(0)
+{
+}
+
+void FRubiksCubeState::Reset(int32 size)
+{
+	Layout = &FRubiksCubeLayout::Get(size);
+
+	PieceCells = Layout->HomeCells;
+	PieceOrientations.Init(0, PieceCells.Num());
+	CellPieces = Layout->HomePieces;
+	Hash = ComputeHash();
+}
+
+void FRubiksCubeState::ApplyMove(const FRubiksMove& move)
+{
+	int32 size = GetSize();
+	uint8 turn = GetTurnOrientation(move.Axis, move.QuarterTurns);
+	if (size == 0 || turn == 0) {
+		return;
+	}
+
+	TArray<int32, TInlineAllocator<64>> layerPieces;
+	if (move.IsWholeCube()) {
+		layerPieces.AddUninitialized(PieceCells.Num());
+		for (int32 x = 0; x < PieceCells.Num(); x++) {
+			layerPieces[x] = x;
+		}
+	}
+	else {
+		if (move.Layer < 0 || move.Layer >= size) {
+			return;
+		}
+		for (int32 a = 0; a < size; a++) {
+			for (int32 b = 0; b < size; b++) {
+				FIntVector coordinates(0, 0, 0);
+				coordinates[move.Axis] = move.Layer;
+				coordinates[(move.Axis + 1) % 3] = a;
+				coordinates[(move.Axis + 2) % 3] = b;
+				int32 piece = CellPieces[GetCellIndex(coordinates)];
+				if (piece != INDEX_NONE) {
+					layerPieces.Add(piece);
+				}
+			}
+		}
+	}
+
+	//Rotate around the cube center using doubled coordinates so the center stays integral
+	FIntVector center(size - 1, size - 1, size - 1);
+	for (int32 piece : layerPieces) {
+		FIntVector doubled = GetCellCoordinates(PieceCells[piece]) * 2 - center;
+		FIntVector rotated = (RotateAxisVector(turn, doubled) + center) / 2;
+
+		Hash ^= GetPieceKey(size, piece, PieceCells[piece], PieceOrientations[piece]);
+		PieceCells[piece] = GetCellIndex(rotated);
+		PieceOrientations[piece] = ComposeOrientations(turn, PieceOrientations[piece]);
+		Hash ^= GetPieceKey(size, piece, PieceCells[piece], PieceOrientations[piece]);
+	}
+
+	//The occupied cells of a layer map onto themselves, so every old entry gets overwritten
+	for (int32 piece : layerPieces) {
+		CellPieces[PieceCells[piece]] = piece;
+	}
+}
+
+void FRubiksCubeState::ApplyCellPermutation(const TArray<int32>& cellTargets, const TArray<uint8>& orientationDeltas)
+{
+	int32 size = GetSize();
+	if (size == 0 || cellTargets.Num() != CellPieces.Num() || orientationDeltas.Num() != CellPieces.Num()) {
+		return;
+	}
+
+	for (int32 piece = 0; piece < PieceCells.Num(); piece++) {
+		int32 cell = PieceCells[piece];
+
+		Hash ^= GetPieceKey(size, piece, cell, PieceOrientations[piece]);
+		PieceCells[piece] = cellTargets[cell];
+		PieceOrientations[piece] = ComposeOrientations(orientationDeltas[cell], PieceOrientations[piece]);
+		Hash ^= GetPieceKey(size, piece, PieceCells[piece], PieceOrientations[piece]);
+	}
+
+	//Every occupied cell receives exactly one piece
+	for (int32 piece = 0; piece < PieceCells.Num(); piece++) {
+		CellPieces[PieceCells[piece]] = piece;
+	}
+}
+
+bool FRubiksCubeState::IsSolved() const
+{
+	if (!Layout) {
+		return false;
+	}
+
+	for (int32 x = 0; x < PieceCells.Num(); x++) {
+		if (PieceCells[x] != Layout->HomeCells[x]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool FRubiksCubeState::IsSolvedInAnyOrientation() const
+{
+	if (!Layout) {
+		return false;
+	}
+
+	//The whole cube may have been turned since the start: every piece must share the rotation of piece 1
+	//and sit in the cell that rotation takes its home cell to
+	uint8 rotation = PieceOrientations[0];
+	FIntVector center(Layout->Size - 1, Layout->Size - 1, Layout->Size - 1);
+	for (int32 x = 0; x < PieceCells.Num(); x++) {
+		if (PieceOrientations[x] != rotation) {
+			return false;
+		}
+
+		FIntVector doubled = GetCellCoordinates(Layout->HomeCells[x]) * 2 - center;
+		if (PieceCells[x] != GetCellIndex((RotateAxisVector(rotation, doubled) + center) / 2)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void FRubiksCubeState::SetPiece(int32 pieceIndex, int32 cell, uint8 orientation)
+{
+	int32 size = GetSize();
+
+	Hash ^= GetPieceKey(size, pieceIndex, PieceCells[pieceIndex], PieceOrientations[pieceIndex]);
+	PieceCells[pieceIndex] = cell;
+	PieceOrientations[pieceIndex] = orientation;
+	Hash ^= GetPieceKey(size, pieceIndex, cell, orientation);
+
+	CellPieces[cell] = pieceIndex;
+}
+
+uint64 FRubiksCubeState::ComputeHash() const
+{
+	uint64 hash = 0;
+	for (int32 x = 0; x < PieceCells.Num(); x++) {
+		hash ^= GetPieceKey(GetSize(), x, PieceCells[x], PieceOrientations[x]);
+	}
+	return hash;
+}
+
+void FRubiksCubeState::GetLayerPieces(ERotationGroup::RotationGroup axis, int32 layer, TArray<int32>& outPieces) const
+{
+	outPieces.Reset();
+
+	if (layer == INDEX_NONE) {
+		for (int32 x = 0; x < PieceCells.Num(); x++) {
+			outPieces.Add(x);
+		}
+		return;
+	}
+
+	int32 size = GetSize();
+	if (layer < 0 || layer >= size) {
+		return;
+	}
+
+	for (int32 a = 0; a < size; a++) {
+		for (int32 b = 0; b < size; b++) {
+			FIntVector coordinates(0, 0, 0);
+			coordinates[axis] = layer;
+			coordinates[(axis + 1) % 3] = a;
+			coordinates[(axis + 2) % 3] = b;
+			int32 piece = CellPieces[GetCellIndex(coordinates)];
+			if (piece != INDEX_NONE) {
+				outPieces.Add(piece);
+			}
+		}
+	}
+}
+
+FIntVector FRubiksCubeState::GetCellCoordinates(int32 cell) const
+{
+	int32 size = GetSize();
+	return FIntVector(cell % size, (cell / size) % size, cell / (size * size));
+}
+
+int32 FRubiksCubeState::GetCellIndex(const FIntVector& coordinates) const
+{
+	int32 size = GetSize();
+	return coordinates.X + coordinates.Y * size + coordinates.Z * size * size;
+}
+
+FTransform FRubiksCubeState::GetPieceTransform(int32 pieceIndex, float cellExtent) const
+{
+	FIntVector coordinates = GetCellCoordinates(PieceCells[pieceIndex]);
+	return FTransform(GetOrientationQuat(PieceOrientations[pieceIndex]), FVector(coordinates) * cellExtent);
+}
+
+SIZE_T FRubiksCubeState::GetAllocatedSize() const
+{
+	return PieceCells.GetAllocatedSize() + PieceOrientations.GetAllocatedSize() + CellPieces.GetAllocatedSize();
+}
+
+bool FRubiksCubeState::operator==(const FRubiksCubeState& other) const
+{
+	return Layout == other.Layout && Hash == other.Hash && PieceCells == other.PieceCells && PieceOrientations == other.PieceOrientations;
+}
+
+uint8 FRubiksCubeState::ComposeOrientations(uint8 outer, uint8 inner)
+{
+	return GetOrientationTable().Compose[outer][inner];
+}
+
+uint8 FRubiksCubeState::InvertOrientation(uint8 orientation)
+{
+	return GetOrientationTable().Inverse[orientation];
+}
+
+uint8 FRubiksCubeState::GetTurnOrientation(ERotationGroup::RotationGroup axis, int32 quarterTurns)
+{
+	const FOrientationTable& table = GetOrientationTable();
+
+	uint8 result = 0;
+	int32 turns = ((quarterTurns % 4) + 4) % 4;
+	for (int32 x = 0; x < turns; x++) {
+		result = table.Compose[table.QuarterTurn[axis]][result];
+	}
+	return result;
+}
+
+FIntVector FRubiksCubeState::RotateAxisVector(uint8 orientation, const FIntVector& vector)
+{
+	return GetOrientationTable().Rotate(orientation, vector);
+}
+
+FQuat FRubiksCubeState::GetOrientationQuat(uint8 orientation)
+{
+	return GetOrientationTable().Quats[orientation];
+}
+
+uint64 FRubiksCubeState::GetPieceKey(int32 size, int32 pieceIndex, int32 cell, uint8 orientation)
+{
+	//SplitMix64 finalizer over the packed arguments
+	uint64 key = ((uint64)size << 56) ^ ((uint64)pieceIndex << 32) ^ ((uint64)cell << 5) ^ (uint64)orientation;
+	key += 0x9E3779B97F4A7C15ull;
+	key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ull;
+	key = (key ^ (key >> 27)) * 0x94D049BB133111EBull;
+	return key ^ (key >> 31);
+}
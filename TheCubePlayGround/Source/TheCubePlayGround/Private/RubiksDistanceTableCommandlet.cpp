@@ -0,0 +1,42 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RubiksDistanceTableCommandlet.h"
+#include "TheCubePlayGround.h"
+#include "Rubiks2x2DistanceTable.h"
+#include "Misc/Parse.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogRubiksDistanceTable, Log, All);
+
+
+URubiksDistanceTableCommandlet::URubiksDistanceTableCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+
+	HelpDescription = TEXT("Generates the 2x2x2 optimal distance table loaded by the cubes at runtime");
+	HelpUsage = TEXT("-run=RubiksDistanceTable [-Output=file]");
+}
+
+int32 URubiksDistanceTableCommandlet::Main(const FString& Params)
+{
+	FString filename = FRubiks2x2DistanceTable::GetDefaultFilename();
+	FParse::Value(*Params, TEXT("Output="), filename, false);
+
+	FRubiks2x2DistanceTable table;
+	table.Generate();
+
+	const TArray<int32>& depthCounts = table.GetDepthCounts();
+	for (int32 depth = 0; depth < depthCounts.Num(); depth++) {
+		UE_LOG(LogRubiksDistanceTable, Display, TEXT("  %2d moves: %d"), depth, depthCounts[depth]);
+	}
+
+	if (!table.SaveToFile(filename)) {
+		UE_LOG(LogRubiksDistanceTable, Error, TEXT("Can't write %s"), *filename);
+		return 1;
+	}
+
+	UE_LOG(LogRubiksDistanceTable, Display, TEXT("Wrote %s"), *filename);
+	return 0;
+}
@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RubiksHintAsyncAction.h"
+#include "TheCubePlayGround.h"
+#include "RubiksCube.h"
+#include "RubiksHintSolver.h"
+#include "RubiksTranspositionCache.h"
+#include "Async/Async.h"
+
+
+URubiksHintAsyncAction* URubiksHintAsyncAction::FindRubiksHint(ARubiksCube* cube, int32 maxSearchDepth)
+{
+	URubiksHintAsyncAction* action = NewObject<URubiksHintAsyncAction>();
+	action->Cube = cube;
+	action->MaxSearchDepth = maxSearchDepth;
+	action->RegisterWithGameInstance(cube);
+	return action;
+}
+
+void URubiksHintAsyncAction::Activate()
+{
+	ARubiksCube* cube = Cube.Get();
+	if (cube == NULL || cube->GetLogicalState().GetNumPieces() == 0) {
+		OnFailed.Broadcast(FRubiksMove(), INDEX_NONE);
+		SetReadyToDestroy();
+		return;
+	}
+
+	FRubiksTranspositionCache* cache = &FRubiksTranspositionCache::Get();
+	const FRubiksCubeState& state = cube->GetLogicalState();
+
+	FRubiksMove nextMove;
+	int32 movesToSolved;
+	bool bFound = FRubiksHintSolver(*cache).FindCachedHint(state, MaxSearchDepth, nextMove, movesToSolved);
+	if (bFound || movesToSolved != INDEX_NONE) {
+		Finish(state.GetHash(), bFound, nextMove, movesToSolved);
+		return;
+	}
+
+	//The task works on its own copy, the cube keeps turning meanwhile
+	TWeakObjectPtr<URubiksHintAsyncAction> weakThis(this);
+	FRubiksCubeState stateCopy = state;
+	int32 maxSearchDepth = MaxSearchDepth;
+	Async<void>(EAsyncExecution::ThreadPool, [weakThis, stateCopy, maxSearchDepth, cache]() {
+		FRubiksMove move;
+		int32 distance;
+		bool bSearchFound = FRubiksHintSolver(*cache).FindHint(stateCopy, maxSearchDepth, move, distance);
+
+		uint64 hash = stateCopy.GetHash();
+		AsyncTask(ENamedThreads::GameThread, [weakThis, hash, bSearchFound, move, distance]() {
+			if (URubiksHintAsyncAction* action = weakThis.Get()) {
+				action->Finish(hash, bSearchFound, move, distance);
+			}
+		});
+	});
+}
+
+void URubiksHintAsyncAction::Finish(uint64 stateHash, bool bFound, FRubiksMove nextMove, int32 movesToSolved)
+{
+	//A hint for a state the cube already left would be wrong
+	ARubiksCube* cube = Cube.Get();
+	if (cube == NULL || cube->GetLogicalState().GetHash() != stateHash) {
+		OnFailed.Broadcast(FRubiksMove(), INDEX_NONE);
+	}
+	else if (bFound) {
+		OnFound.Broadcast(nextMove, movesToSolved);
+	}
+	else {
+		OnFailed.Broadcast(nextMove, movesToSolved);
+	}
+
+	SetReadyToDestroy();
+}
@@ -0,0 +1,172 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RubiksHintSolver.h"
+#include "TheCubePlayGround.h"
+#include "RubiksTranspositionCache.h"
+
+
+FRubiksHintSolver::FRubiksHintSolver(FRubiksTranspositionCache& cache, int32 maxNodes)
+	: Cache(cache), MaxNodes(maxNodes), NumNodes(0)
+{
+}
+
+bool FRubiksHintSolver::FindCachedHint(const FRubiksCubeState& state, int32 maxDepth, FRubiksMove& outMove, int32& outDistance) const
+{
+	if (state.IsSolvedInAnyOrientation()) {
+		outMove = FRubiksMove(ERotationGroup::X, 0, 0);
+		outDistance = 0;
+		return true;
+	}
+
+	FRubiksHintEntry entry;
+	if (Cache.Find(state.GetHash(), entry)) {
+		if (entry.bExact) {
+			outMove = entry.BestMove;
+			outDistance = entry.Distance;
+			return true;
+		}
+		if (entry.Distance > maxDepth) {
+			outDistance = entry.Distance;
+			return false;
+		}
+	}
+
+	outDistance = INDEX_NONE;
+	return false;
+}
+
+bool FRubiksHintSolver::FindHint(const FRubiksCubeState& state, int32 maxDepth, FRubiksMove& outMove, int32& outDistance)
+{
+	if (FindCachedHint(state, maxDepth, outMove, outDistance)) {
+		return true;
+	}
+	if (outDistance != INDEX_NONE) {
+		return false;
+	}
+
+	//Depths below a bound left by an earlier search are known to fail
+	int32 firstDepth = 1;
+	FRubiksHintEntry entry;
+	if (Cache.Find(state.GetHash(), entry)) {
+		firstDepth = FMath::Max(entry.Distance, 1);
+	}
+
+	NumNodes = 0;
+	FRubiksCubeState searchState = state;
+	for (int32 depth = firstDepth; depth <= maxDepth; depth++) {
+		Path.Reset();
+		if (!Search(searchState, depth, NULL)) {
+			if (NumNodes > MaxNodes) {
+				//Every depth below this one was searched in full, the next query starts here
+				StoreBound(state, depth);
+				outDistance = INDEX_NONE;
+				return false;
+			}
+			continue;
+		}
+
+		//Every state along an optimal path is itself solved optimally by the rest of the path
+		FRubiksCubeState pathState = state;
+		for (int32 x = 0; x < Path.Num(); x++) {
+			FRubiksHintEntry pathEntry;
+			pathEntry.Hash = pathState.GetHash();
+			pathEntry.BestMove = Path[x];
+			pathEntry.Distance = Path.Num() - x;
+			pathEntry.bExact = true;
+			Cache.Store(pathEntry);
+
+			pathState.ApplyMove(Path[x]);
+		}
+
+		outMove = Path[0];
+		outDistance = Path.Num();
+		return true;
+	}
+
+	//Only the root tried every move, so only its bound holds for other searches
+	StoreBound(state, maxDepth + 1);
+
+	outDistance = maxDepth + 1;
+	return false;
+}
+
+void FRubiksHintSolver::StoreBound(const FRubiksCubeState& state, int32 distance)
+{
+	FRubiksHintEntry bound;
+	bound.Hash = state.GetHash();
+	bound.Distance = distance;
+	bound.bExact = false;
+	Cache.Store(bound);
+}
+
+bool FRubiksHintSolver::Search(FRubiksCubeState& state, int32 depthLeft, const FRubiksMove* lastMove)
+{
+	if (++NumNodes > MaxNodes) {
+		return false;
+	}
+	if (state.IsSolvedInAnyOrientation()) {
+		return true;
+	}
+	if (depthLeft == 0) {
+		return false;
+	}
+
+	//Most states are one move from the leaves, where the loop below is as cheap as locking the cache
+	if (depthLeft >= 2) {
+		FRubiksHintEntry entry;
+		if (Cache.Find(state.GetHash(), entry)) {
+			if (entry.Distance > depthLeft) {
+				return false;
+			}
+
+			//Follow a known optimal move first
+			if (entry.bExact) {
+				Path.Add(entry.BestMove);
+				state.ApplyMove(entry.BestMove);
+				bool found = Search(state, depthLeft - 1, &entry.BestMove);
+				state.ApplyMove(entry.BestMove.GetInverse());
+				if (found) {
+					return true;
+				}
+				Path.Pop(false);
+			}
+		}
+	}
+
+	//Path ends with lastMove, the move before it tells whether the last layer already made a half turn
+	bool lastWasHalfTurn = lastMove && Path.Num() >= 2 && Path[Path.Num() - 2].Axis == lastMove->Axis && Path[Path.Num() - 2].Layer == lastMove->Layer;
+
+	int32 size = state.GetSize();
+	for (int32 axis = 0; axis < 3; axis++) {
+		for (int32 layer = 0; layer < size; layer++) {
+			//Turns of the same axis commute, so only try them in increasing layer order
+			if (lastMove && lastMove->Axis == axis && layer < lastMove->Layer) {
+				continue;
+			}
+
+			bool sameLayer = lastMove && lastMove->Axis == axis && lastMove->Layer == layer;
+			if (sameLayer && lastWasHalfTurn) {
+				continue;
+			}
+
+			for (int32 direction = -1; direction <= 1; direction += 2) {
+				//A layer turns at most a half turn in a row, always written as two clockwise quarter turns
+				if (sameLayer && (direction < 0 || lastMove->QuarterTurns < 0)) {
+					continue;
+				}
+
+				FRubiksMove move((ERotationGroup::RotationGroup)axis, layer, direction);
+				Path.Add(move);
+				state.ApplyMove(move);
+				bool found = Search(state, depthLeft - 1, &move);
+				state.ApplyMove(move.GetInverse());
+				if (found) {
+					return true;
+				}
+				Path.Pop(false);
+			}
+		}
+	}
+
+	return false;
+}
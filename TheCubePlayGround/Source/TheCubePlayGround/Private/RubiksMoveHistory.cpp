@@ -0,0 +1,153 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RubiksMoveHistory.h"
+#include "TheCubePlayGround.h"
+
+
+FRubiksMoveHistory::FRubiksMoveHistory()
+	: FirstIndex(0), CurrentIndex(0), CheckpointInterval(32), MaxMoves(4096)
+{
+}
+
+void FRubiksMoveHistory::Reset(const FRubiksCubeState& initialState, int32 checkpointInterval, int32 maxMoves)
+{
+	CheckpointInterval = FMath::Max(checkpointInterval, 1);
+
+	//Keep room for at least two checkpoints, otherwise the oldest moves could never be dropped
+	MaxMoves = FMath::Max(maxMoves, CheckpointInterval * 2);
+
+	Moves.Empty();
+	Checkpoints.Empty();
+	FirstIndex = 0;
+	CurrentIndex = 0;
+
+	FCheckpoint first;
+	first.MoveIndex = 0;
+	first.State = initialState;
+	Checkpoints.Add(first);
+}
+
+void FRubiksMoveHistory::Push(const FRubiksMove& move, const FRubiksCubeState& stateAfter)
+{
+	Truncate();
+
+	Moves.Add(move);
+	CurrentIndex++;
+
+	AfterPush(stateAfter);
+}
+
+void FRubiksMoveHistory::PushMoves(const TArray<FRubiksMove>& moves, const FRubiksCubeState& stateBefore)
+{
+	if (moves.Num() == 0) {
+		return;
+	}
+
+	Truncate();
+
+	//Short batches that end before the next checkpoint don't need any state
+	if (CurrentIndex + moves.Num() - Checkpoints.Last().MoveIndex < CheckpointInterval) {
+		Moves.Append(moves);
+		CurrentIndex += moves.Num();
+		return;
+	}
+
+	FRubiksCubeState state = stateBefore;
+	for (const FRubiksMove& move : moves) {
+		state.ApplyMove(move);
+		Moves.Add(move);
+		CurrentIndex++;
+
+		AfterPush(state);
+	}
+}
+
+bool FRubiksMoveHistory::Undo(FRubiksMove& outMove)
+{
+	if (CurrentIndex <= FirstIndex) {
+		return false;
+	}
+
+	CurrentIndex--;
+	outMove = Moves[CurrentIndex - FirstIndex].GetInverse();
+	return true;
+}
+
+bool FRubiksMoveHistory::Redo(FRubiksMove& outMove)
+{
+	if (CurrentIndex >= GetLastIndex()) {
+		return false;
+	}
+
+	outMove = Moves[CurrentIndex - FirstIndex];
+	CurrentIndex++;
+	return true;
+}
+
+bool FRubiksMoveHistory::Seek(int32 moveIndex, FRubiksCubeState& outState)
+{
+	if (moveIndex < FirstIndex || moveIndex > GetLastIndex() || Checkpoints.Num() == 0) {
+		return false;
+	}
+
+	//Binary search the last checkpoint at or before moveIndex
+	int32 low = 0;
+	int32 high = Checkpoints.Num() - 1;
+	while (low < high) {
+		int32 middle = (low + high + 1) / 2;
+		if (Checkpoints[middle].MoveIndex <= moveIndex) {
+			low = middle;
+		}
+		else {
+			high = middle - 1;
+		}
+	}
+
+	const FCheckpoint& checkpoint = Checkpoints[low];
+	outState = checkpoint.State;
+	for (int32 x = checkpoint.MoveIndex; x < moveIndex; x++) {
+		outState.ApplyMove(Moves[x - FirstIndex]);
+	}
+
+	CurrentIndex = moveIndex;
+	return true;
+}
+
+SIZE_T FRubiksMoveHistory::GetAllocatedSize() const
+{
+	SIZE_T size = Moves.GetAllocatedSize() + Checkpoints.GetAllocatedSize();
+	for (const FCheckpoint& checkpoint : Checkpoints) {
+		size += checkpoint.State.GetAllocatedSize();
+	}
+	return size;
+}
+
+void FRubiksMoveHistory::Truncate()
+{
+	if (CurrentIndex >= GetLastIndex()) {
+		return;
+	}
+
+	Moves.SetNum(CurrentIndex - FirstIndex, false);
+	while (Checkpoints.Num() > 1 && Checkpoints.Last().MoveIndex > CurrentIndex) {
+		Checkpoints.Pop(false);
+	}
+}
+
+void FRubiksMoveHistory::AfterPush(const FRubiksCubeState& stateAfter)
+{
+	if (CurrentIndex - Checkpoints.Last().MoveIndex >= CheckpointInterval) {
+		FCheckpoint checkpoint;
+		checkpoint.MoveIndex = CurrentIndex;
+		checkpoint.State = stateAfter;
+		Checkpoints.Add(checkpoint);
+	}
+
+	//Drop the oldest block of moves, the second checkpoint becomes the new start of the history
+	while (Moves.Num() > MaxMoves && Checkpoints.Num() > 1) {
+		int32 dropped = Checkpoints[1].MoveIndex - FirstIndex;
+		Moves.RemoveAt(0, dropped, false);
+		Checkpoints.RemoveAt(0, 1, false);
+		FirstIndex += dropped;
+	}
+}
@@ -7,8 +7,8 @@
 // Sets default values
 ARubiksPiece::ARubiksPiece()
 {
- 	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
+	//Pieces are moved by their cube, they never need to tick
+	PrimaryActorTick.bCanEverTick = false;
 
 	cubePieceID = -1;
 }
@@ -20,13 +20,6 @@ void ARubiksPiece::BeginPlay()
 	this->StartPosition = this->GetActorLocation();
 }
 
-// Called every frame
-void ARubiksPiece::Tick( float DeltaTime )
-{
-	Super::Tick( DeltaTime );
-
-}
-
 //Check if ht piece is at its start position
 bool ARubiksPiece::IsAtStartPosition()
 {
@@ -0,0 +1,137 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RubiksReachabilityCommandlet.h"
+#include "TheCubePlayGround.h"
+#include "RubiksAlgorithm.h"
+#include "Rubiks2x2Reachability.h"
+#include "Misc/Parse.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogRubiksReachability, Log, All);
+
+#define REACHABILITY_DEFAULT_MOVES TEXT("U,U',D,D',F,F',B,B',R,R',L,L'")
+
+
+URubiksReachabilityCommandlet::URubiksReachabilityCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+
+	HelpDescription = TEXT("Checks whether a 2x2x2 room layout can be reached with a set of moves, and in how many moves");
+	HelpUsage = TEXT("-run=RubiksReachability -Moves=\"U,U',R,R'\" [-Start=algorithm] [-Target=2,1,3,4,5,6,7,8 | -TargetAlgorithm=algorithm [-IgnoreOrientation]]");
+}
+
+int32 URubiksReachabilityCommandlet::Main(const FString& Params)
+{
+	FString error;
+
+	//Allowed moves
+	FString movesString = REACHABILITY_DEFAULT_MOVES;
+	FParse::Value(*Params, TEXT("Moves="), movesString, false);
+
+	TArray<FString> moveNotations;
+	movesString.ParseIntoArray(moveNotations, TEXT(","), true);
+
+	FRubiks2x2Reachability reachability;
+	for (const FString& notation : moveNotations) {
+		FRubiksAlgorithmPtr algorithm = FRubiksAlgorithm::FindOrCompile(notation, 2, error);
+		if (!algorithm.IsValid()) {
+			UE_LOG(LogRubiksReachability, Error, TEXT("Invalid move \"%s\": %s"), *notation, *error);
+			return 1;
+		}
+		reachability.AddMove(*algorithm);
+	}
+
+	if (reachability.GetNumMoves() == 0) {
+		UE_LOG(LogRubiksReachability, Error, TEXT("No moves allowed"));
+		return 1;
+	}
+
+	//Starting layout
+	FRubiksCubeState start;
+	start.Reset(2);
+
+	FString startNotation;
+	if (FParse::Value(*Params, TEXT("Start="), startNotation, false)) {
+		FRubiksAlgorithmPtr algorithm = FRubiksAlgorithm::FindOrCompile(startNotation, 2, error);
+		if (!algorithm.IsValid()) {
+			UE_LOG(LogRubiksReachability, Error, TEXT("Invalid start \"%s\": %s"), *startNotation, *error);
+			return 1;
+		}
+		algorithm->Apply(start);
+	}
+
+	//Wanted layout, as the cell of each piece or as a whole state
+	const FRubiksCubeLayout& layout = FRubiksCubeLayout::Get(2);
+	TArray<int32> targets;
+
+	FString targetString;
+	FString targetNotation;
+	if (FParse::Value(*Params, TEXT("Target="), targetString, false)) {
+		TArray<FString> pieceIDs;
+		targetString.ParseIntoArray(pieceIDs, TEXT(","), true);
+
+		TArray<int32> pieceCells;
+		pieceCells.Init(INDEX_NONE, layout.HomeCells.Num());
+		for (int32 x = 0; x < pieceIDs.Num() && x < layout.HomeCells.Num(); x++) {
+			int32 pieceID = FCString::Atoi(*pieceIDs[x]);
+			if (pieceID >= 1 && pieceID <= pieceCells.Num() && pieceCells[pieceID - 1] == INDEX_NONE) {
+				pieceCells[pieceID - 1] = layout.HomeCells[x];
+			}
+		}
+
+		if (pieceIDs.Num() != pieceCells.Num() || pieceCells.Contains(INDEX_NONE)) {
+			UE_LOG(LogRubiksReachability, Error, TEXT("-Target must list each piece ID from 1 to %d once"), pieceCells.Num());
+			return 1;
+		}
+
+		FRubiks2x2Reachability::GetStatesWithPieceCells(pieceCells, targets);
+	}
+	else if (FParse::Value(*Params, TEXT("TargetAlgorithm="), targetNotation, false)) {
+		FRubiksAlgorithmPtr algorithm = FRubiksAlgorithm::FindOrCompile(targetNotation, 2, error);
+		if (!algorithm.IsValid()) {
+			UE_LOG(LogRubiksReachability, Error, TEXT("Invalid target \"%s\": %s"), *targetNotation, *error);
+			return 1;
+		}
+
+		FRubiksCubeState target;
+		target.Reset(2);
+		algorithm->Apply(target);
+
+		if (FParse::Param(*Params, TEXT("IgnoreOrientation"))) {
+			TArray<int32> pieceCells;
+			for (int32 piece = 0; piece < target.GetNumPieces(); piece++) {
+				pieceCells.Add(target.GetPieceCell(piece));
+			}
+			FRubiks2x2Reachability::GetStatesWithPieceCells(pieceCells, targets);
+		}
+		else {
+			targets.Add(FRubiks2x2Reachability::GetIndex(target));
+		}
+	}
+
+	UE_LOG(LogRubiksReachability, Display, TEXT("Searching with %d moves: %s"), reachability.GetNumMoves(), *movesString);
+
+	double startTime = FPlatformTime::Seconds();
+	reachability.Search(start, targets);
+
+	const TArray<int32>& depthCounts = reachability.GetDepthCounts();
+	UE_LOG(LogRubiksReachability, Display, TEXT("Reached %lld of %d layouts, all within %d moves (%.2fs)"),
+		reachability.GetNumReached(), (int32)FRubiks2x2Reachability::NumStates, depthCounts.Num() - 1, FPlatformTime::Seconds() - startTime);
+
+	for (int32 depth = 0; depth < depthCounts.Num(); depth++) {
+		UE_LOG(LogRubiksReachability, Display, TEXT("  %2d moves: %d"), depth, depthCounts[depth]);
+	}
+
+	if (targets.Num() > 0) {
+		if (reachability.GetTargetDepth() != INDEX_NONE) {
+			UE_LOG(LogRubiksReachability, Display, TEXT("Target is reachable in %d moves"), reachability.GetTargetDepth());
+		}
+		else {
+			UE_LOG(LogRubiksReachability, Display, TEXT("Target is NOT reachable with these moves"));
+		}
+	}
+
+	return 0;
+}
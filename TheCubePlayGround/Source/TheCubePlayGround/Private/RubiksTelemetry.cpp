@@ -0,0 +1,211 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RubiksTelemetry.h"
+#include "TheCubePlayGround.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/Event.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformProcess.h"
+#include "Misc/Compression.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/DateTime.h"
+#include "Misc/Paths.h"
+
+#define TELEMETRY_MAGIC 0x314C5452 //"RTL1"
+#define TELEMETRY_VERSION 2
+
+//Records gathered before compressing them as one block (64KB)
+#define TELEMETRY_BLOCK_RECORDS 2048
+
+//Write a partial block at least this often so little is lost on a crash
+#define TELEMETRY_FLUSH_SECONDS 2.0
+
+#define TELEMETRY_MAX_FILE_SIZE (4 * 1024 * 1024)
+
+//Oldest files are deleted past this many
+#define TELEMETRY_MAX_FILES 16
+
+
+FRubiksTelemetry& FRubiksTelemetry::Get()
+{
+	static FRubiksTelemetry* Telemetry = []()
+	{
+		FRubiksTelemetry* telemetry = new FRubiksTelemetry();
+		FCoreDelegates::OnPreExit.AddRaw(telemetry, &FRubiksTelemetry::Shutdown);
+		return telemetry;
+	}();
+
+	return *Telemetry;
+}
+
+FRubiksTelemetry::FRubiksTelemetry()
+	: Queue(Capacity), Thread(NULL), WakeEvent(NULL), File(NULL), FileSize(0), FileNumber(0)
+{
+	SessionName = FDateTime::Now().ToString();
+	StartCycles = FPlatformTime::Cycles64();
+
+	if (FPlatformProcess::SupportsMultithreading()) {
+		WakeEvent = FPlatformProcess::GetSynchEventFromPool();
+		Thread = FRunnableThread::Create(this, TEXT("RubiksTelemetry"), 0, TPri_BelowNormal);
+	}
+}
+
+FRubiksTelemetry::~FRubiksTelemetry()
+{
+	Shutdown();
+}
+
+FString FRubiksTelemetry::GetDirectory()
+{
+	return FPaths::GameSavedDir() / TEXT("Rubiks") / TEXT("Telemetry");
+}
+
+void FRubiksTelemetry::Shutdown()
+{
+	if (Thread) {
+		Stop();
+		Thread->WaitForCompletion();
+		delete Thread;
+		Thread = NULL;
+
+		FPlatformProcess::ReturnSynchEventToPool(WakeEvent);
+		WakeEvent = NULL;
+	}
+	else {
+		//No writer thread on this platform, write everything from here
+		Drain();
+		WriteBlock();
+		CloseFile();
+	}
+
+	if (NumDropped.GetValue() > 0) {
+		UE_LOG(LogTemp, Warning, TEXT("%d telemetry records were dropped because the ring was full"), NumDropped.GetValue());
+	}
+}
+
+uint32 FRubiksTelemetry::Run()
+{
+	double lastWriteTime = FPlatformTime::Seconds();
+
+	while (!bStopping) {
+		//The game thread never signals, it only pushes, so poll
+		WakeEvent->Wait(50);
+
+		Drain();
+
+		if (PendingBytes.Num() > 0 && FPlatformTime::Seconds() - lastWriteTime >= TELEMETRY_FLUSH_SECONDS) {
+			WriteBlock();
+			lastWriteTime = FPlatformTime::Seconds();
+		}
+	}
+
+	Drain();
+	WriteBlock();
+	CloseFile();
+	return 0;
+}
+
+void FRubiksTelemetry::Stop()
+{
+	bStopping = true;
+	if (WakeEvent) {
+		WakeEvent->Trigger();
+	}
+}
+
+void FRubiksTelemetry::Drain()
+{
+	FRubiksTelemetryRecord record;
+	while (Queue.Dequeue(record)) {
+		int32 offset = PendingBytes.AddUninitialized((int32)sizeof(record));
+		FMemory::Memcpy(PendingBytes.GetData() + offset, &record, sizeof(record));
+
+		if (PendingBytes.Num() >= TELEMETRY_BLOCK_RECORDS * (int32)sizeof(record)) {
+			WriteBlock();
+		}
+	}
+}
+
+void FRubiksTelemetry::WriteBlock()
+{
+	if (PendingBytes.Num() == 0) {
+		return;
+	}
+
+	if (!File || FileSize >= TELEMETRY_MAX_FILE_SIZE) {
+		OpenNextFile();
+	}
+
+	int32 uncompressedSize = PendingBytes.Num();
+	int32 compressedSize = FCompression::CompressMemoryBound(COMPRESS_ZLIB, uncompressedSize);
+	CompressedBytes.SetNumUninitialized(compressedSize, false);
+	if (!FCompression::CompressMemory(COMPRESS_ZLIB, CompressedBytes.GetData(), compressedSize, PendingBytes.GetData(), uncompressedSize)) {
+		UE_LOG(LogTemp, Warning, TEXT("Can't compress %d bytes of telemetry"), uncompressedSize);
+		PendingBytes.Reset();
+		return;
+	}
+
+	if (File) {
+		//Running total, so a reader sees where records went missing
+		int32 numDropped = NumDropped.GetValue();
+		*File << uncompressedSize << compressedSize << numDropped;
+		File->Serialize(CompressedBytes.GetData(), compressedSize);
+		File->Flush();
+		FileSize += 3 * sizeof(int32) + compressedSize;
+	}
+
+	PendingBytes.Reset();
+}
+
+void FRubiksTelemetry::OpenNextFile()
+{
+	CloseFile();
+
+	FString directory = GetDirectory();
+	IFileManager::Get().MakeDirectory(*directory, true);
+
+	FString filename = directory / FString::Printf(TEXT("Telemetry_%s_%03d.rtl"), *SessionName, FileNumber++);
+	File = IFileManager::Get().CreateFileWriter(*filename);
+	FileSize = 0;
+	if (!File) {
+		UE_LOG(LogTemp, Warning, TEXT("Can't write telemetry file %s"), *filename);
+		return;
+	}
+
+	uint32 magic = TELEMETRY_MAGIC;
+	uint32 version = TELEMETRY_VERSION;
+	uint32 recordSize = sizeof(FRubiksTelemetryRecord);
+	uint32 reserved = 0;
+	double secondsPerCycle = FPlatformTime::GetSecondsPerCycle64();
+	uint64 startCycles = StartCycles;
+	*File << magic << version << recordSize << reserved << secondsPerCycle << startCycles;
+	FileSize = File->Tell();
+
+	DeleteOldFiles();
+}
+
+void FRubiksTelemetry::CloseFile()
+{
+	if (File) {
+		File->Close();
+		delete File;
+		File = NULL;
+	}
+}
+
+void FRubiksTelemetry::DeleteOldFiles()
+{
+	FString directory = GetDirectory();
+
+	TArray<FString> filenames;
+	IFileManager::Get().FindFiles(filenames, *(directory / TEXT("Telemetry_*.rtl")), true, false);
+	if (filenames.Num() <= TELEMETRY_MAX_FILES) {
+		return;
+	}
+
+	//Names start with the session date, so they sort oldest first
+	filenames.Sort();
+	for (int32 x = 0; x < filenames.Num() - TELEMETRY_MAX_FILES; x++) {
+		IFileManager::Get().Delete(*(directory / filenames[x]));
+	}
+}
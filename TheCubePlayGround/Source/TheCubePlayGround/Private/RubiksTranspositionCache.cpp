@@ -0,0 +1,185 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RubiksTranspositionCache.h"
+#include "TheCubePlayGround.h"
+#include "Misc/ScopeLock.h"
+#include "Misc/Paths.h"
+#include "HAL/FileManager.h"
+#include "Serialization/Archive.h"
+
+#define HINT_CACHE_MAGIC 0x52484331 //"RHC1"
+#define HINT_CACHE_VERSION 1
+
+
+FRubiksTranspositionCache::FRubiksTranspositionCache(int32 capacityLog2)
+{
+	capacityLog2 = FMath::Clamp(capacityLog2, 4, 28);
+
+	Slots.SetNumZeroed(1 << capacityLog2);
+	SlotMask = (uint64)Slots.Num() - 1;
+}
+
+FRubiksTranspositionCache& FRubiksTranspositionCache::Get()
+{
+	//2^18 slots of 16 bytes (4MB)
+	static FRubiksTranspositionCache* Cache = []()
+	{
+		FRubiksTranspositionCache* cache = new FRubiksTranspositionCache(18);
+		cache->LoadFromFile(GetDefaultFilename());
+		return cache;
+	}();
+
+	return *Cache;
+}
+
+bool FRubiksTranspositionCache::Find(uint64 hash, FRubiksHintEntry& outEntry) const
+{
+	uint64 slotIndex = hash & SlotMask;
+
+	FScopeLock lock(&GetLock(slotIndex));
+
+	const FSlot& slot = Slots[slotIndex];
+	if (slot.Hash != hash || hash == 0) {
+		return false;
+	}
+
+	outEntry.Hash = slot.Hash;
+	outEntry.BestMove = FRubiksMove((ERotationGroup::RotationGroup)slot.Axis, slot.Layer, slot.QuarterTurns);
+	outEntry.Distance = slot.Distance;
+	outEntry.bExact = slot.bExact != 0;
+	return true;
+}
+
+void FRubiksTranspositionCache::Store(const FRubiksHintEntry& entry)
+{
+	if (entry.Hash == 0) {
+		return;
+	}
+
+	uint64 slotIndex = entry.Hash & SlotMask;
+
+	FScopeLock lock(&GetLock(slotIndex));
+
+	FSlot& slot = Slots[slotIndex];
+	if (slot.Hash != 0) {
+		//Never trade an exact distance for a bound, and prefer the entry that was more expensive to search
+		bool oldExact = slot.bExact != 0;
+		if (oldExact && !entry.bExact) {
+			return;
+		}
+		if (oldExact == entry.bExact && slot.Distance > entry.Distance) {
+			return;
+		}
+	}
+
+	slot.Hash = entry.Hash;
+	slot.Layer = (int16)entry.BestMove.Layer;
+	slot.Axis = (uint8)entry.BestMove.Axis;
+	slot.QuarterTurns = (int8)entry.BestMove.QuarterTurns;
+	slot.Distance = (uint8)FMath::Min(entry.Distance, 255);
+	slot.bExact = entry.bExact ? 1 : 0;
+	slot.Padding = 0;
+}
+
+void FRubiksTranspositionCache::Clear()
+{
+	for (int32 x = 0; x < NumLocks; x++) {
+		Locks[x].Lock();
+	}
+
+	FMemory::Memzero(Slots.GetData(), Slots.Num() * sizeof(FSlot));
+
+	for (int32 x = NumLocks - 1; x >= 0; x--) {
+		Locks[x].Unlock();
+	}
+}
+
+bool FRubiksTranspositionCache::SaveToFile(const FString& filename) const
+{
+	IFileManager::Get().MakeDirectory(*FPaths::GetPath(filename), true);
+
+	FArchive* writer = IFileManager::Get().CreateFileWriter(*filename);
+	if (!writer) {
+		UE_LOG(LogTemp, Warning, TEXT("Can't write hint cache %s"), *filename);
+		return false;
+	}
+
+	uint32 magic = HINT_CACHE_MAGIC;
+	uint32 version = HINT_CACHE_VERSION;
+	int32 count = GetNumUsedSlots();
+	*writer << magic << version << count;
+
+	for (int32 x = 0; x < Slots.Num(); x++) {
+		FScopeLock lock(&GetLock(x));
+
+		FSlot slot = Slots[x];
+		if (slot.Hash == 0 || count-- <= 0) {
+			continue;
+		}
+		*writer << slot.Hash << slot.Layer << slot.Axis << slot.QuarterTurns << slot.Distance << slot.bExact;
+	}
+
+	//Slots freed by a concurrent Clear are written as empty entries so the count stays right
+	FSlot empty;
+	FMemory::Memzero(&empty, sizeof(FSlot));
+	while (count-- > 0) {
+		*writer << empty.Hash << empty.Layer << empty.Axis << empty.QuarterTurns << empty.Distance << empty.bExact;
+	}
+
+	bool success = !writer->IsError();
+	delete writer;
+	return success;
+}
+
+bool FRubiksTranspositionCache::LoadFromFile(const FString& filename)
+{
+	FArchive* reader = IFileManager::Get().CreateFileReader(*filename);
+	if (!reader) {
+		return false;
+	}
+
+	uint32 magic = 0;
+	uint32 version = 0;
+	int32 count = 0;
+	*reader << magic << version << count;
+
+	if (magic != HINT_CACHE_MAGIC || version != HINT_CACHE_VERSION) {
+		UE_LOG(LogTemp, Warning, TEXT("Hint cache %s is not a valid cache file"), *filename);
+		delete reader;
+		return false;
+	}
+
+	for (int32 x = 0; x < count && !reader->IsError(); x++) {
+		FSlot slot;
+		*reader << slot.Hash << slot.Layer << slot.Axis << slot.QuarterTurns << slot.Distance << slot.bExact;
+
+		FRubiksHintEntry entry;
+		entry.Hash = slot.Hash;
+		entry.BestMove = FRubiksMove((ERotationGroup::RotationGroup)slot.Axis, slot.Layer, slot.QuarterTurns);
+		entry.Distance = slot.Distance;
+		entry.bExact = slot.bExact != 0;
+		Store(entry);
+	}
+
+	bool success = !reader->IsError();
+	delete reader;
+	return success;
+}
+
+FString FRubiksTranspositionCache::GetDefaultFilename()
+{
+	return FPaths::GameSavedDir() / TEXT("Rubiks") / TEXT("HintCache.bin");
+}
+
+int32 FRubiksTranspositionCache::GetNumUsedSlots() const
+{
+	int32 used = 0;
+	for (int32 x = 0; x < Slots.Num(); x++) {
+		FScopeLock lock(&GetLock(x));
+
+		if (Slots[x].Hash != 0) {
+			used++;
+		}
+	}
+	return used;
+}
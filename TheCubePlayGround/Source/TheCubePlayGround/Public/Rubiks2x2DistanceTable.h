@@ -0,0 +1,77 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RubiksCubeState.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+//Optimal quarter turn distance of every 2x2x2 state, 4 bits per state.
+//States are counted up to a whole cube rotation: the cube is first turned so piece 1 is home with no rotation,
+//which leaves 7! permutations times 3^6 twists of the other seven pieces (3674160 states).
+//"Solved" is the start arrangement including piece orientations, seen from any side, like FRubiksCubeState::IsSolvedInAnyOrientation.
+class THECUBEPLAYGROUND_API FRubiks2x2DistanceTable
+{
+public:
+	enum { NumStates = 5040 * 729 };
+
+	//Turns of the far layer of each axis (layer 1, the one piece 1 is not in): X-, X+, Y-, Y+, Z-, Z+
+	enum { NumMoves = 6 };
+
+	FRubiks2x2DistanceTable();
+	~FRubiks2x2DistanceTable();
+
+	//Shared table, memory mapped from Content/Rubiks on first use. Left unloaded (and logged once) when the file is missing,
+	//the URubiksDistanceTableCommandlet writes it.
+	static FRubiks2x2DistanceTable& Get();
+
+	//Breadth first search over every state, spread across the task graph
+	void Generate();
+
+	bool SaveToFile(const FString& filename) const;
+
+	//Map a file written by SaveToFile, falls back to reading it into memory where mapping isn't supported
+	bool LoadFromFile(const FString& filename);
+
+	//Content/Rubiks/Distance2x2.bin, staged as a loose file so it can still be mapped in packaged games
+	static FString GetDefaultFilename();
+
+	bool IsLoaded() const { return Data != NULL; }
+
+	//Moves to solved for a 2x2x2 state, INDEX_NONE if the table isn't loaded or the cube isn't 2x2x2
+	int32 GetDistance(const FRubiksCubeState& state) const;
+
+	//One of the twelve layer turns that brings the state one move closer to solved.
+	//Returns false when the state is already solved or the table can't answer.
+	bool GetOptimalMove(const FRubiksCubeState& state, FRubiksMove& outMove, int32& outDistance) const;
+
+	//Packed index of a 2x2x2 state and back (Unrank returns the state seen with piece 1 at home)
+	static int32 Rank(const FRubiksCubeState& state);
+	static void Unrank(int32 index, FRubiksCubeState& outState);
+
+	static FRubiksMove GetMove(int32 moveIndex);
+
+	//Index reached from a state index by one of the NumMoves moves, through the permutation and twist move tables
+	static int32 ApplyMove(int32 index, int32 moveIndex);
+
+	//Number of states at each distance, only filled by Generate: counting a loaded table would touch every page of the file
+	const TArray<int32>& GetDepthCounts() const { return DepthCounts; }
+
+private:
+	//Nibble of each state, 0xF is unvisited
+	TArray<uint32> OwnedWords;
+
+	const uint32* Data;
+
+	IMappedFileHandle* MappedFile;
+	IMappedFileRegion* MappedRegion;
+
+	TArray<int32> DepthCounts;
+
+	int32 GetNibble(int32 index) const { return (Data[index >> 3] >> ((index & 7) * 4)) & 0xF; }
+
+	void Unload();
+	void CountDepths();
+};
@@ -0,0 +1,66 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RubiksCubeState.h"
+#include "Rubiks2x2DistanceTable.h"
+
+class FRubiksAlgorithm;
+
+//Breadth first search over the 2x2x2 states reachable from a start state with a restricted set of moves.
+//Unlike FRubiks2x2DistanceTable, states are absolute (a whole cube rotation is a different room layout):
+//each state is a distance table index times the 24 rotations of piece 1, 88179840 states in all.
+//Visited states and frontiers are bitsets shared by every worker thread.
+class THECUBEPLAYGROUND_API FRubiks2x2Reachability
+{
+public:
+	enum { NumRotations = 24 };
+	enum { NumStates = FRubiks2x2DistanceTable::NumStates * NumRotations };
+
+	FRubiks2x2Reachability();
+
+	//Allow a move, any algorithm compiled for a 2x2x2 cube (a whole algorithm counts as one move).
+	//Returns false if the algorithm isn't for a 2x2x2 cube.
+	bool AddMove(const FRubiksAlgorithm& algorithm);
+
+	int32 GetNumMoves() const { return NumMoves; }
+
+	//Search every state reachable from start with the allowed moves.
+	//targets are state indices, GetTargetDepth then tells how many moves the closest one is away.
+	void Search(const FRubiksCubeState& start, const TArray<int32>& targets);
+
+	bool IsReachable(int32 index) const;
+
+	//Moves to the closest target, INDEX_NONE if none is reachable
+	int32 GetTargetDepth() const { return TargetDepth; }
+
+	//Number of states first reached at each depth
+	const TArray<int32>& GetDepthCounts() const { return DepthCounts; }
+
+	int64 GetNumReached() const;
+
+	//Absolute index of a reachable state and back
+	static int32 GetIndex(const FRubiksCubeState& state);
+	static void GetState(int32 index, FRubiksCubeState& outState);
+
+	//Every state with the given piece in each cell, whatever the piece orientations
+	static void GetStatesWithPieceCells(const TArray<int32>& pieceCells, TArray<int32>& outIndices);
+
+private:
+	//For each allowed move and rotation of piece 1: the rotation afterwards and the distance table moves to play.
+	//The table moves of transition t are TableMoves[TableMoveStarts[t]] up to TableMoves[TableMoveStarts[t + 1]].
+	TArray<uint8> NextRotations;
+	TArray<int32> TableMoveStarts;
+	TArray<uint8> TableMoves;
+	int32 NumMoves;
+
+	TArray<uint32> Visited;
+
+	TArray<int32> DepthCounts;
+	int32 TargetDepth;
+
+	//Set a bit shared with other threads, returns false if it was already set
+	static bool SetBit(TArray<uint32>& bits, int32 index);
+	static bool GetBit(const TArray<uint32>& bits, int32 index) { return (bits[index >> 5] & (1u << (index & 31))) != 0; }
+};
@@ -0,0 +1,64 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RubiksCubeState.h"
+
+class FRubiksAlgorithm;
+
+typedef TSharedPtr<const FRubiksAlgorithm, ESPMode::ThreadSafe> FRubiksAlgorithmPtr;
+
+//An algorithm written in cube notation, compiled for one cube size into a single cell permutation and orientation change.
+//
+//Notation (SiGN, spaces optional):
+//  U D F B R L        outer layer, clockwise seen from that face
+//  2R, 3U ...         only the n-th layer from that face
+//  Rw, r, 3Rw, 3r     the n outer layers together (2 when n is left out)
+//  2-3Rw, 2-3r        layers 2 to 3 from that face
+//  M E S              every inner layer, turning like L, D and F
+//  x y z              the whole cube, turning like R, U and F
+//  ' or a count       R' counter clockwise, R2 half turn, R2' the other way round
+//  ( ... )n'          a group, repeated n times and/or inverted
+class THECUBEPLAYGROUND_API FRubiksAlgorithm
+{
+public:
+	FRubiksAlgorithm();
+
+	//Compiled algorithm for a cube size, compiled on first use and shared after that (the cache holds a few hundred at most).
+	//Safe to call from any thread.
+	//Returns NULL and fills outError when the notation can't be read.
+	static FRubiksAlgorithmPtr FindOrCompile(const FString& notation, int32 size, FString& outError);
+
+	static void ClearCache();
+
+	//Read the notation into layer turns. A step is one written move, wide and slice moves turn several layers in one step.
+	static bool Parse(const FString& notation, int32 size, TArray<FRubiksMove>& outMoves, TArray<int32>& outStepStarts, FString& outError);
+
+	bool Compile(const FString& notation, int32 size, FString& outError);
+
+	//Apply every move of the algorithm in one pass over the pieces
+	void Apply(FRubiksCubeState& state) const;
+
+	int32 GetSize() const { return Size; }
+	const FString& GetNotation() const { return Notation; }
+	const TArray<FRubiksMove>& GetMoves() const { return Moves; }
+
+	int32 GetNumSteps() const { return StepStarts.Num(); }
+
+	//Range of Moves turned together by a step
+	void GetStep(int32 stepIndex, int32& outFirstMove, int32& outNumMoves) const;
+
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	FString Notation;
+	int32 Size;
+
+	TArray<FRubiksMove> Moves;
+	TArray<int32> StepStarts;
+
+	//For each cell, where its piece ends up and the rotation added to it (INDEX_NONE for the inner cells)
+	TArray<int32> CellTargets;
+	TArray<uint8> OrientationDeltas;
+};
@@ -3,25 +3,62 @@
 #pragma once
 
 #include "GameFramework/Actor.h"
+#include "RubiksCubeState.h"
+#include "RubiksMoveHistory.h"
+#include "RubiksAlgorithm.h"
+#include "RubiksTelemetry.h"
 #include "RubiksCube.generated.h"
 
-UENUM(BlueprintType)
-namespace ERotationGroup
-{
-	enum RotationGroup
-	{
-		X UMETA(DisplayName = "Pieces with same X"),
-		Y UMETA(DisplayName = "Pieces with same Y"),
-		Z UMETA(DisplayName = "Pieces with same Z")
-	};
-}
-
 
 #define CUBE_EXTENT 94
 #define CUBE_PIECE_TAG "CubePiece"
 #define CUBE_ROTATE_THRESHOLD 15.0
 
 
+//What a ray hit on the cube, see ARubiksCube::PickPiece
+USTRUCT(BlueprintType)
+struct THECUBEPLAYGROUND_API FRubiksPickResult
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Category = Rubiks, VisibleAnywhere, BlueprintReadOnly)
+		int32 PieceID;
+
+	//NULL for logical only cubes
+	UPROPERTY(Category = Rubiks, VisibleAnywhere, BlueprintReadOnly)
+		class ARubiksPiece* Piece;
+
+	//Same numbering as the RotateFromPiece functions: 1 Top, 2 Bottom, 3 Back, 4 Front, 5 Right, 6 Left
+	UPROPERTY(Category = Rubiks, VisibleAnywhere, BlueprintReadOnly)
+		int32 Face;
+
+	//Normal of the face that was hit, in cube space and in world space
+	UPROPERTY(Category = Rubiks, VisibleAnywhere, BlueprintReadOnly)
+		FVector LocalNormal;
+
+	UPROPERTY(Category = Rubiks, VisibleAnywhere, BlueprintReadOnly)
+		FVector WorldNormal;
+
+	//Layer that rotating from this face turns
+	UPROPERTY(Category = Rubiks, VisibleAnywhere, BlueprintReadOnly)
+		TEnumAsByte<ERotationGroup::RotationGroup> Axis;
+
+	UPROPERTY(Category = Rubiks, VisibleAnywhere, BlueprintReadOnly)
+		int32 Layer;
+
+	UPROPERTY(Category = Rubiks, VisibleAnywhere, BlueprintReadOnly)
+		FVector HitLocation;
+
+	UPROPERTY(Category = Rubiks, VisibleAnywhere, BlueprintReadOnly)
+		float Distance;
+
+	FRubiksPickResult()
+		: PieceID(-1), Piece(NULL), Face(-1), LocalNormal(0, 0, 0), WorldNormal(0, 0, 0), Axis(ERotationGroup::X), Layer(0), HitLocation(0, 0, 0), Distance(0)
+	{
+	}
+};
+
+
 UCLASS(Blueprintable)
 class THECUBEPLAYGROUND_API ARubiksCube : public AActor
 {
@@ -37,18 +74,91 @@ private:
 	UPROPERTY()
 		TArray <class ARubiksPiece*> PotentialPiecesToRotateGroup;
 
-	float passRotationTime;
-
 	bool isRotating;
 
 	FRotator destRotation;
 
-	void RotateGroup(FName name, class ARubiksPiece * piece, ERotationGroup::RotationGroup groupAxis, FRotator rotation);
+	//Returns false if the piece isn't part of the cube
+	bool RotateGroup(FName name, int32 pieceID, ERotationGroup::RotationGroup groupAxis, FRotator rotation);
+
+	//Shared body of the RotateFromPiece functions, deferred rotations wait for RotateFromPieceDoRotation.
+	//Returns the face that was turned (or will be, when deferred), -1 when nothing was.
+	int32 RotateFromPieceIDInternal(FVector normal, int32 pieceID, bool clockwise, bool deferred);
+
+	//Face a normal points out of (1 Top, 2 Bottom, 3 Back, 4 Front, 5 Right, 6 Left or -1) and the rotation that turns its group
+	int32 GetFaceRotation(FVector normal, bool clockwise, ERotationGroup::RotationGroup& groupAxis, FRotator& rotation);
+
+	//Animates our rotations along with every other cube of the world
+	TWeakObjectPtr<class ARubiksCubeManager> RotationManager;
+
+	friend class ARubiksCubeManager;
+
+	//Called by the manager when the rotation is over
+	void FinishLayerRotation();
+
+	//Start the animated rotation of a layer, it is committed to the logical state once the layer gets there
+	void BeginLayerRotation(const FRubiksMove& move);
+
+	//Same for several layers of one axis turning together (wide and slice moves)
+	void BeginLayerRotation(const FRubiksMove* moves, int32 numMoves);
+
+	//Moves of the rotation being animated. Until it finishes, the logical state and every query on it
+	//(IsCubeSolved, GetPieceTransformByID, telemetry) still see the cube as it was before the turn.
+	TArray<FRubiksMove> PendingMoves;
+
+	//Algorithm being played by PlayAlgorithm and its next step
+	FRubiksAlgorithmPtr PlayingAlgorithm;
+	int32 PlayingStep;
+
+	void PlayNextAlgorithmStep();
+
+	//Time of the last player input and the time since the one before, carried to the move it commits
+	double LastInputTime;
+	float PendingSinceLastInput;
+
+	//Solved state after the last recorded change, so only becoming solved is recorded
+	bool bWasSolved;
+
+	//Note a player input, returns the seconds since the previous one
+	float NoteInput();
+
+	//Push an event to the telemetry sink when bRecordTelemetry is set
+	void RecordTelemetry(ERubiksTelemetryEvent::Type type, const FRubiksMove& move, float sinceLastInput, int32 value);
+	void RecordSolvedTelemetry();
+
+	//Apply a move to the logical state and record it in the history
+	void CommitMove(const FRubiksMove& move);
+
+	//Apply a move to the logical state right away and write the transforms of the pieces it moved
+	void ApplyMoveInstantly(const FRubiksMove& move);
+
+	//Attach pieces back to the cube and snap them to their logical transforms
+	void SyncPiecesToLogicalState(const TArray<int32>& pieceIndices);
+	void SyncAllPiecesToLogicalState();
+
+	//Cells and orientations of every piece, the pieces' transforms always follow it
+	FRubiksCubeState LogicalState;
+
+	FRubiksMoveHistory MoveHistory;
 
 
 	ERotationGroup::RotationGroup potentialRotationGroup;
 	FRotator potentialRotator;
-	class ARubiksPiece * potentialPiece;
+	int32 potentialPieceID;
+
+	//No piece actors, only the logical state (set by BuildCube)
+	bool bLogicalOnly;
+
+	//Boxes standing in for the pieces of the rotating layer when there are no piece actors
+	UPROPERTY()
+		TArray <class UBoxComponent*> CollisionProxies;
+
+	void EnableCollisionProxies(const TArray<int32>& pieceIndices);
+	void DisableCollisionProxies();
+
+	//Components a spawned piece gets: the native ones of the piece class defaults, then for Blueprint piece classes
+	//the construction script templates (which never exist on the class defaults)
+	void GetPieceComponentTemplates(TArray<class UActorComponent*>& outTemplates) const;
 
 public:
 	UPROPERTY(Category = Rubiks, EditAnywhere, BlueprintReadWrite)
@@ -63,6 +173,26 @@ public:
 	UPROPERTY(Category = Rubiks, EditAnywhere, BlueprintReadWrite)
 		float totalRotationTime;
 
+	//Pieces ignore visibility and camera traces (they still block pawns and physics), use PickPiece instead of traces to find them
+	UPROPERTY(Category = Rubiks, EditAnywhere, BlueprintReadWrite)
+		bool bDisablePieceQueryCollision;
+
+	//Send moves, rejected inputs and solves to the telemetry files in Saved/Rubiks/Telemetry
+	UPROPERTY(Category = Rubiks, EditAnywhere, BlueprintReadWrite)
+		bool bRecordTelemetry;
+
+	//Keep only the logical state and spawn no piece actors, always the case on dedicated servers
+	UPROPERTY(Category = Rubiks, EditAnywhere, BlueprintReadWrite)
+		bool bForceLogicalOnly;
+
+	//Number of moves between two logical checkpoints of the move history
+	UPROPERTY(Category = Rubiks, EditAnywhere, BlueprintReadWrite)
+		int32 HistoryCheckpointInterval;
+
+	//Oldest moves are forgotten past this many moves
+	UPROPERTY(Category = Rubiks, EditAnywhere, BlueprintReadWrite)
+		int32 MaxHistoryMoves;
+
 	UPROPERTY(Category = Rubiks, VisibleAnywhere, BlueprintReadOnly)
 		class USceneComponent * DummyRoot;
 
@@ -80,8 +210,7 @@ public:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
-	// Called every frame
-	virtual void Tick(float DeltaSeconds) override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 	UFUNCTION(Category = Rubiks, BlueprintCallable)
 		void DestroyCube();
@@ -102,7 +231,8 @@ public:
 	UFUNCTION(Category = Rubiks, BlueprintCallable)
 		ARubiksPiece* getCubePieceByID(int32 inputID);
 
-	//Rotate Cube
+	//Rotate Cube. The RotateFromPiece functions return the face turned (1 Top, 2 Bottom, 3 Back, 4 Front, 5 Right, 6 Left),
+	//-1 when nothing turned: a layer is still rotating, the normal isn't a face normal or the piece isn't part of the cube
 	UFUNCTION(Category = Rubiks, BlueprintCallable)
 		int32 RotateFromPieceClockwise(FVector normal, class ARubiksPiece * piece);
 
@@ -129,4 +259,117 @@ public:
 	UFUNCTION(Category = Rubiks, BlueprintCallable)
 		void RotateFromPieceDoRotation();
 
+
+	// --------------------- Piece ID versions, also work without piece actors -------------------------------------------
+
+	UFUNCTION(Category = Rubiks, BlueprintCallable)
+		int32 RotateFromPieceIDClockwise(FVector normal, int32 pieceID);
+
+	UFUNCTION(Category = Rubiks, BlueprintCallable)
+		int32 RotateFromPieceIDCounterClockwise(FVector normal, int32 pieceID);
+
+	UFUNCTION(Category = Rubiks, BlueprintCallable)
+		TArray<int32> TargetPieceIDsToRotateGroup(FVector normal, int32 pieceID);
+
+	UFUNCTION(Category = Rubiks, BlueprintCallable)
+		int32 RotateFromPieceIDClockwiseWithCollisionDetection(FVector normal, int32 pieceID);
+
+	UFUNCTION(Category = Rubiks, BlueprintCallable)
+		int32 RotateFromPieceIDCounterClockwiseWithCollisionDetection(FVector normal, int32 pieceID);
+
+	//Find the piece, face and layer a world space ray hits by walking the cube's cells, without any physics trace.
+	//Works at any cube orientation, returns false if the ray misses or a layer is rotating.
+	UFUNCTION(Category = Rubiks, BlueprintCallable)
+		bool PickPiece(FVector rayOrigin, FVector rayDirection, FRubiksPickResult& result);
+
+	//World transform of a piece, from the logical state
+	UFUNCTION(Category = Rubiks, BlueprintCallable)
+		FTransform GetPieceTransformByID(int32 pieceID);
+
+	UFUNCTION(Category = Rubiks, BlueprintCallable)
+		bool IsLogicalOnly() const;
+
+	//Memory used by this cube's logical state, piece actors and collision proxies (also written to the log)
+	UFUNCTION(Category = Rubiks, BlueprintCallable)
+		FString GetMemoryReport();
+
+	//Telemetry records dropped this session because the writer thread fell behind (shared by every cube), 0 when bRecordTelemetry is off
+	UFUNCTION(Category = Rubiks, BlueprintCallable)
+		int32 GetDroppedTelemetryRecords() const;
+
+
+	// --------------------- Move history -------------------------------------------
+
+	//Undo the last move instantly, returns false if there is nothing to undo or a layer is rotating
+	UFUNCTION(Category = Rubiks, BlueprintCallable)
+		bool UndoMove();
+
+	//Replay the last undone move instantly
+	UFUNCTION(Category = Rubiks, BlueprintCallable)
+		bool RedoMove();
+
+	//Jump to the state after moveIndex moves (see GetMoveHistoryRange) and update every piece once
+	UFUNCTION(Category = Rubiks, BlueprintCallable)
+		bool RewindToMove(int32 moveIndex);
+
+	UFUNCTION(Category = Rubiks, BlueprintCallable)
+		int32 GetCurrentMoveIndex() const;
+
+	//Oldest and newest move index that can still be reached
+	UFUNCTION(Category = Rubiks, BlueprintCallable)
+		void GetMoveHistoryRange(int32& firstIndex, int32& lastIndex) const;
+
+
+	// --------------------- Hints -------------------------------------------
+
+	//Zobrist hash of the current cube state, as 16 hex digits since Blueprints have no 64 bit integers
+	UFUNCTION(Category = Rubiks, BlueprintCallable)
+		FString GetStateHash() const;
+
+	//Best next move and number of moves left to solve the cube, only from what is already known (solved or in the hint cache).
+	//Returns false when the answer isn't known, movesToSolved is then a lower bound or -1 when only a search could tell:
+	//use Find Rubiks Hint (URubiksHintAsyncAction) to search on a worker thread. nextMove has 0 quarter turns when already solved.
+	UFUNCTION(Category = Rubiks, BlueprintCallable)
+		bool GetHint(int32 maxSearchDepth, FRubiksMove& nextMove, int32& movesToSolved);
+
+	//Cells and orientations of every piece, as of the last finished move
+	const FRubiksCubeState& GetLogicalState() const { return LogicalState; }
+
+	//Write the hint cache shared by every cube to Saved/Rubiks
+	UFUNCTION(Category = Rubiks, BlueprintCallable)
+		static bool SaveHintCache();
+
+	//2x2x2 only: optimal number of moves back to the start arrangement (in any whole cube orientation),
+	//-1 for other sizes or when Content/Rubiks/Distance2x2.bin is missing
+	UFUNCTION(Category = Rubiks, BlueprintCallable)
+		int32 GetOptimalMovesToSolved();
+
+	//2x2x2 only: a layer turn that brings the cube one move closer to solved, read from the distance table
+	UFUNCTION(Category = Rubiks, BlueprintCallable)
+		bool GetOptimalMove(FRubiksMove& nextMove, int32& movesToSolved);
+
+
+	// --------------------- Algorithms -------------------------------------------
+	//Algorithms are written in SiGN notation ("R U R' U'", "(r U2 R')2", "3Rw M' x2"), see FRubiksAlgorithm.
+	//They are compiled once per cube size and cached.
+
+	//Apply a whole algorithm at once: one pass over the pieces whatever its length. Returns false if a layer is rotating or the notation is invalid.
+	UFUNCTION(Category = Rubiks, BlueprintCallable)
+		bool ApplyAlgorithm(const FString& notation);
+
+	//Animate an algorithm move by move, wide and slice moves turn their layers together
+	UFUNCTION(Category = Rubiks, BlueprintCallable)
+		bool PlayAlgorithm(const FString& notation);
+
+	//Stop playing once the current move is done
+	UFUNCTION(Category = Rubiks, BlueprintCallable)
+		void StopAlgorithm();
+
+	UFUNCTION(Category = Rubiks, BlueprintCallable)
+		bool IsPlayingAlgorithm() const;
+
+	//Check an algorithm for a cube size, error tells what is wrong with it
+	UFUNCTION(Category = Rubiks, BlueprintCallable)
+		static bool IsValidAlgorithm(const FString& notation, int32 cubeSize, FString& error);
+
 };
@@ -0,0 +1,49 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "GameFramework/Actor.h"
+#include "RubiksCubeManager.generated.h"
+
+class ARubiksCube;
+
+//One per world, spawned on demand. Advances the layer rotations of every cube in a single tick
+//so idle cubes and pieces don't need to tick at all. Rotations are kept as parallel arrays.
+UCLASS(NotBlueprintable, Transient)
+class THECUBEPLAYGROUND_API ARubiksCubeManager : public AActor
+{
+	GENERATED_BODY()
+
+private:
+	UPROPERTY()
+		TArray <ARubiksCube*> Cubes;
+
+	TArray<float> PassRotationTimes;
+	TArray<float> TotalRotationTimes;
+	TArray<FRotator> DestRotations;
+
+	//Relative rotation of each cube's PieceRotator for this frame
+	TArray<FQuat> FrameRotations;
+
+	void RemoveRotationAt(int32 index);
+
+public:
+	//Compute the frame rotations on worker threads once this many cubes are rotating
+	UPROPERTY(Category = Rubiks, EditAnywhere, BlueprintReadWrite)
+		int32 ParallelRotationThreshold;
+
+	ARubiksCubeManager();
+
+	virtual void Tick(float DeltaSeconds) override;
+
+	//The manager of a world, spawned the first time it's needed
+	static ARubiksCubeManager* Get(UWorld* world);
+
+	//Start turning a cube's PieceRotator from no rotation to destRotation over totalRotationTime
+	void AddRotation(ARubiksCube* cube, float totalRotationTime, FRotator destRotation);
+
+	//Stop a rotation without finishing it (the cube is going away)
+	void RemoveRotation(ARubiksCube* cube);
+
+	int32 GetNumRotations() const { return Cubes.Num(); }
+};
@@ -0,0 +1,151 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RubiksCubeState.generated.h"
+
+UENUM(BlueprintType)
+namespace ERotationGroup
+{
+	enum RotationGroup
+	{
+		X UMETA(DisplayName = "Pieces with same X"),
+		Y UMETA(DisplayName = "Pieces with same Y"),
+		Z UMETA(DisplayName = "Pieces with same Z")
+	};
+}
+
+
+//A quarter turn of one layer (or of the whole cube) in cube-local space.
+//QuarterTurns follow the FRotator sign used by ARubiksCube: X turns are Roll, Y turns are Pitch, Z turns are Yaw.
+USTRUCT(BlueprintType)
+struct THECUBEPLAYGROUND_API FRubiksMove
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Category = Rubiks, EditAnywhere, BlueprintReadWrite)
+		TEnumAsByte<ERotationGroup::RotationGroup> Axis;
+
+	//Layer index along Axis (0 .. CubeSize - 1), INDEX_NONE rotates the whole cube
+	UPROPERTY(Category = Rubiks, EditAnywhere, BlueprintReadWrite)
+		int32 Layer;
+
+	//+1 / -1 for a quarter turn, +2 / -2 for a half turn
+	UPROPERTY(Category = Rubiks, EditAnywhere, BlueprintReadWrite)
+		int32 QuarterTurns;
+
+	FRubiksMove()
+		: Axis(ERotationGroup::X), Layer(0), QuarterTurns(1)
+	{
+	}
+
+	FRubiksMove(ERotationGroup::RotationGroup inAxis, int32 inLayer, int32 inQuarterTurns)
+		: Axis(inAxis), Layer(inLayer), QuarterTurns(inQuarterTurns)
+	{
+	}
+
+	bool IsWholeCube() const { return Layer == INDEX_NONE; }
+
+	FRubiksMove GetInverse() const { return FRubiksMove(Axis, Layer, -QuarterTurns); }
+
+	//Rotator that turns the layer the same way as the move (matches the rotators used by RotateGroup)
+	FRotator ToRotator() const;
+
+	bool operator==(const FRubiksMove& other) const
+	{
+		return Axis == other.Axis && Layer == other.Layer && QuarterTurns == other.QuarterTurns;
+	}
+};
+
+
+//Home cells of the pieces of a cube of a given size. Shared by every state of that size and never freed.
+struct THECUBEPLAYGROUND_API FRubiksCubeLayout
+{
+	int32 Size;
+
+	//Home cell of each piece (piece index = cubePieceID - 1)
+	TArray<int32> HomeCells;
+
+	//Piece that starts in each cell, INDEX_NONE for the hidden inner cells
+	TArray<int32> HomePieces;
+
+	//Returns the layout for a cube size, building it on first use. Safe to call from any thread.
+	static const FRubiksCubeLayout& Get(int32 size);
+};
+
+
+//Logical state of a cube: which cell every piece is in and how it is oriented.
+//Pieces are numbered like ARubiksCube::BuildCube spawns them, cells are flattened as x + y * Size + z * Size * Size.
+//Orientations index the 24 rotations of the cube (0 is the identity).
+struct THECUBEPLAYGROUND_API FRubiksCubeState
+{
+	FRubiksCubeState();
+
+	//Put every piece back to its home cell with no rotation
+	void Reset(int32 size);
+
+	//Apply a move in O(layer) (O(pieces) for whole cube moves)
+	void ApplyMove(const FRubiksMove& move);
+
+	//Same check as ARubiksCube::IsCubeSolved: every piece is back in its home cell
+	bool IsSolved() const;
+
+	//The start arrangement seen from any side, piece orientations included: every piece has the same rotation and is
+	//where turning the whole cube by it takes its home cell. Used by the hints, the distance table (its distance 0) and telemetry.
+	bool IsSolvedInAnyOrientation() const;
+
+	//Zobrist hash of the piece cells and orientations, kept up to date by ApplyMove
+	uint64 GetHash() const { return Hash; }
+
+	//Hash recomputed from scratch, only useful to check GetHash
+	uint64 ComputeHash() const;
+
+	//Move a piece straight to a cell and orientation, keeping the hash up to date.
+	//Used to rebuild states from packed indices, the caller must leave every piece in its own cell.
+	void SetPiece(int32 pieceIndex, int32 cell, uint8 orientation);
+
+	//Move every piece at once in O(pieces): the piece in cell c goes to cellTargets[c] and is turned by orientationDeltas[c].
+	//Used by compiled algorithms, cellTargets must map the occupied cells onto themselves.
+	void ApplyCellPermutation(const TArray<int32>& cellTargets, const TArray<uint8>& orientationDeltas);
+
+	//Collect the pieces currently in a layer (every piece for INDEX_NONE)
+	void GetLayerPieces(ERotationGroup::RotationGroup axis, int32 layer, TArray<int32>& outPieces) const;
+
+	int32 GetSize() const { return Layout ? Layout->Size : 0; }
+	int32 GetNumPieces() const { return PieceCells.Num(); }
+	int32 GetPieceCell(int32 pieceIndex) const { return PieceCells[pieceIndex]; }
+	uint8 GetPieceOrientation(int32 pieceIndex) const { return PieceOrientations[pieceIndex]; }
+	int32 GetPieceInCell(int32 cell) const { return CellPieces[cell]; }
+
+	FIntVector GetCellCoordinates(int32 cell) const;
+	int32 GetCellIndex(const FIntVector& coordinates) const;
+
+	//Cube-local location and rotation of a piece, as spawned by BuildCube
+	FTransform GetPieceTransform(int32 pieceIndex, float cellExtent) const;
+
+	//Memory used by this state, excluding the shared layout
+	SIZE_T GetAllocatedSize() const;
+
+	bool operator==(const FRubiksCubeState& other) const;
+
+	//Helpers for the 24 cube rotations
+	static uint8 ComposeOrientations(uint8 outer, uint8 inner);
+	static uint8 InvertOrientation(uint8 orientation);
+	static uint8 GetTurnOrientation(ERotationGroup::RotationGroup axis, int32 quarterTurns);
+	static FIntVector RotateAxisVector(uint8 orientation, const FIntVector& vector);
+	static FQuat GetOrientationQuat(uint8 orientation);
+
+	//Zobrist key of a piece in a cell with an orientation.
+	//Keys are derived from the arguments instead of a random table so hashes stay valid across runs and cube sizes.
+	static uint64 GetPieceKey(int32 size, int32 pieceIndex, int32 cell, uint8 orientation);
+
+private:
+	const FRubiksCubeLayout* Layout;
+
+	TArray<int32> PieceCells;
+	TArray<uint8> PieceOrientations;
+	TArray<int32> CellPieces;
+
+	uint64 Hash;
+};
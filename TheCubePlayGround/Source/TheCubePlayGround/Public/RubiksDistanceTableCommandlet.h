@@ -0,0 +1,22 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+#include "RubiksDistanceTableCommandlet.generated.h"
+
+//Generates the 2x2x2 distance table shipped in Content/Rubiks, see FRubiks2x2DistanceTable.
+//Only needed again if the table format or the piece layout changes.
+//
+//UE4Editor-Cmd.exe TheCubePlayGround -run=RubiksDistanceTable
+//  -Output=  file to write (default: FRubiks2x2DistanceTable::GetDefaultFilename)
+UCLASS()
+class THECUBEPLAYGROUND_API URubiksDistanceTableCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	URubiksDistanceTableCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
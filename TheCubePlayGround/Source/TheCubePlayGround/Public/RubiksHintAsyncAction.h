@@ -0,0 +1,43 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Kismet/BlueprintAsyncActionBase.h"
+#include "RubiksCubeState.h"
+#include "RubiksHintAsyncAction.generated.h"
+
+class ARubiksCube;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FRubiksHintResultPin, FRubiksMove, NextMove, int32, MovesToSolved);
+
+//Hint search on a worker thread, so deep scrambles never stall the game thread.
+//Answers known from the hint cache are given right away, without starting a task.
+UCLASS()
+class THECUBEPLAYGROUND_API URubiksHintAsyncAction : public UBlueprintAsyncActionBase
+{
+	GENERATED_BODY()
+
+public:
+	//Next move and number of moves left to solve the cube. NextMove has 0 quarter turns when already solved.
+	UPROPERTY(BlueprintAssignable)
+		FRubiksHintResultPin OnFound;
+
+	//Not solvable within the search depth (MovesToSolved is a lower bound), or -1 when the search gave up
+	//or the cube moved before it finished (asking again continues from where it stopped)
+	UPROPERTY(BlueprintAssignable)
+		FRubiksHintResultPin OnFailed;
+
+	//Best next move towards solved, searching at most maxSearchDepth moves
+	UFUNCTION(Category = Rubiks, BlueprintCallable, meta = (BlueprintInternalUseOnly = "true"))
+		static URubiksHintAsyncAction* FindRubiksHint(ARubiksCube* cube, int32 maxSearchDepth);
+
+	virtual void Activate() override;
+
+private:
+	TWeakObjectPtr<ARubiksCube> Cube;
+	int32 MaxSearchDepth;
+
+	//Called on the game thread with the result of a search of the state with this hash
+	void Finish(uint64 stateHash, bool bFound, FRubiksMove nextMove, int32 movesToSolved);
+};
@@ -0,0 +1,43 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RubiksCubeState.h"
+
+class FRubiksTranspositionCache;
+
+//Iterative deepening search for the shortest sequence of layer turns back to a solved cube (FRubiksCubeState::IsSolvedInAnyOrientation).
+//Solved paths are shared through a transposition cache, so repeated queries return right away.
+//Each query visits at most maxNodes states, so a deep scramble costs a bounded time. Searches belong on a worker thread
+//(see URubiksHintAsyncAction), the game thread only asks FindCachedHint.
+class THECUBEPLAYGROUND_API FRubiksHintSolver
+{
+public:
+	//A few seconds of a worker thread at most, enough to look about 6 moves deep on a 3x3x3
+	enum { DefaultMaxNodes = 5000000 };
+
+	explicit FRubiksHintSolver(FRubiksTranspositionCache& cache, int32 maxNodes = DefaultMaxNodes);
+
+	//Same answers as FindHint from what is already known (solved or cached) without searching.
+	//outDistance is -1 when only a search could tell.
+	bool FindCachedHint(const FRubiksCubeState& state, int32 maxDepth, FRubiksMove& outMove, int32& outDistance) const;
+
+	//Find the next move towards solved within maxDepth moves. outMove is a move of 0 quarter turns when already solved.
+	//Returns false if the cube can't be solved within maxDepth, outDistance is then a lower bound,
+	//or -1 when the node budget ran out before knowing.
+	bool FindHint(const FRubiksCubeState& state, int32 maxDepth, FRubiksMove& outMove, int32& outDistance);
+
+private:
+	FRubiksTranspositionCache& Cache;
+
+	int32 MaxNodes;
+	int32 NumNodes;
+
+	TArray<FRubiksMove> Path;
+
+	bool Search(FRubiksCubeState& state, int32 depthLeft, const FRubiksMove* lastMove);
+
+	//Store that the state can't be solved in fewer than distance moves
+	void StoreBound(const FRubiksCubeState& state, int32 distance);
+};
@@ -0,0 +1,64 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RubiksCubeState.h"
+
+//Move history with logical checkpoints.
+//Move indices are absolute: index n is the state after the n-th move since Reset, even once old moves have been dropped.
+//A checkpoint is kept at least every CheckpointInterval moves, so seeking replays at most that many moves.
+class THECUBEPLAYGROUND_API FRubiksMoveHistory
+{
+public:
+	FRubiksMoveHistory();
+
+	//Forget every move and start again from the given state
+	void Reset(const FRubiksCubeState& initialState, int32 checkpointInterval, int32 maxMoves);
+
+	//Record a move played from the current index. Drops any redo moves.
+	void Push(const FRubiksMove& move, const FRubiksCubeState& stateAfter);
+
+	//Record several moves played at once from stateBefore. Batches that reach the next checkpoint are replayed
+	//on a copy of stateBefore to take their checkpoints, so seeking inside a batch stays within CheckpointInterval moves.
+	void PushMoves(const TArray<FRubiksMove>& moves, const FRubiksCubeState& stateBefore);
+
+	//Step the cursor back, outMove is the move that undoes it
+	bool Undo(FRubiksMove& outMove);
+
+	//Step the cursor forward, outMove is the move to replay
+	bool Redo(FRubiksMove& outMove);
+
+	//Rebuild the state at a move index from the closest checkpoint and move the cursor there
+	bool Seek(int32 moveIndex, FRubiksCubeState& outState);
+
+	int32 GetCurrentIndex() const { return CurrentIndex; }
+	int32 GetFirstIndex() const { return FirstIndex; }
+	int32 GetLastIndex() const { return FirstIndex + Moves.Num(); }
+
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	struct FCheckpoint
+	{
+		int32 MoveIndex;
+		FRubiksCubeState State;
+	};
+
+	//Moves[x] goes from index FirstIndex + x to FirstIndex + x + 1
+	TArray<FRubiksMove> Moves;
+
+	//Sorted by MoveIndex, the first one is always at FirstIndex
+	TArray<FCheckpoint> Checkpoints;
+
+	int32 FirstIndex;
+	int32 CurrentIndex;
+	int32 CheckpointInterval;
+	int32 MaxMoves;
+
+	//Remove the redo moves (and their checkpoints) past CurrentIndex
+	void Truncate();
+
+	//Add a checkpoint if needed and drop the oldest moves once the history is over budget
+	void AfterPush(const FRubiksCubeState& stateAfter);
+};
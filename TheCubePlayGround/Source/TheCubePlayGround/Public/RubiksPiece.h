@@ -23,9 +23,6 @@ public:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 	
-	// Called every frame
-	virtual void Tick( float DeltaSeconds ) override;
-
 	//Check if ht piece is at its start position
 	bool IsAtStartPosition();
 	
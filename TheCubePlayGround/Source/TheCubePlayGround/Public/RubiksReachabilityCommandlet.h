@@ -0,0 +1,26 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+#include "RubiksReachabilityCommandlet.generated.h"
+
+//Tells level designers whether a room layout of the 2x2x2 map cube can be reached with the moves a level allows,
+//and in how many moves. Searches every reachable state with FRubiks2x2Reachability.
+//
+//UE4Editor-Cmd.exe TheCubePlayGround -run=RubiksReachability -Moves="U,U',R,R'" -Target="2,1,3,4,5,6,7,8"
+//  -Moves=           allowed moves separated by commas, each can be a whole algorithm (default: every quarter turn)
+//  -Start=           algorithm played from the start arrangement to get the starting layout (default: start arrangement)
+//  -Target=          piece ID wanted at the home cell of pieces 1 to 8, any piece orientation
+//  -TargetAlgorithm= algorithm played from the start arrangement to get the wanted layout, orientations included
+//  -IgnoreOrientation  only compare piece cells with -TargetAlgorithm
+UCLASS()
+class THECUBEPLAYGROUND_API URubiksReachabilityCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	URubiksReachabilityCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
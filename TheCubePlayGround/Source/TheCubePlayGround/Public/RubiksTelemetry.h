@@ -0,0 +1,116 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "HAL/ThreadSafeBool.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "Containers/CircularQueue.h"
+
+class FRunnableThread;
+class FEvent;
+class FArchive;
+
+namespace ERubiksTelemetryEvent
+{
+	enum Type : uint8
+	{
+		Move,
+		//Input ignored because a layer was rotating
+		RejectedInput,
+		//The cube just became solved, in any whole cube orientation (FRubiksCubeState::IsSolvedInAnyOrientation)
+		Solved,
+		Undo,
+		Redo,
+		//A whole algorithm applied at once, Value is its number of moves
+		Algorithm
+	};
+}
+
+//One telemetry event, written to the files as is
+struct FRubiksTelemetryRecord
+{
+	//FPlatformTime::Cycles64, the file header has the seconds per cycle
+	uint64 Cycles;
+
+	//UObject unique ID of the cube
+	uint32 CubeID;
+
+	//Seconds since the previous input on the same cube, 0 for events that aren't inputs
+	float SinceLastInput;
+
+	//Move history index after the event
+	int32 MoveIndex;
+
+	int32 Layer;
+	uint8 Type;
+	uint8 Axis;
+	int8 QuarterTurns;
+	uint8 Reserved;
+	int32 Value;
+};
+
+static_assert(sizeof(FRubiksTelemetryRecord) == 32, "Telemetry records are written as fixed 32 byte records");
+
+
+//Telemetry sink shared by every cube.
+//Cubes push records from the game thread into a single producer, single consumer lock-free ring,
+//a background thread drains it into zlib compressed blocks in Saved/Rubiks/Telemetry, starting a new file every few MB.
+//File: 32 byte header (magic "RTL1", version, record size, reserved, seconds per cycle, start cycles),
+//then blocks of uncompressed size, compressed size, records dropped so far in the session and the compressed records.
+class THECUBEPLAYGROUND_API FRubiksTelemetry : public FRunnable
+{
+public:
+	//Records the ring holds, at 32 bytes each
+	enum { Capacity = 16384 };
+
+	//Shared sink, its writer thread starts on first use and stops when the engine exits.
+	//Cubes recording telemetry call it from BeginPlay so the thread never starts in the middle of a move.
+	static FRubiksTelemetry& Get();
+
+	//Game thread only. Never blocks: when the ring is full the record is dropped and counted.
+	FORCEINLINE void Push(const FRubiksTelemetryRecord& record)
+	{
+		if (!Queue.Enqueue(record)) {
+			NumDropped.Increment();
+		}
+	}
+
+	//Records dropped since the start of the session, also written in every block and logged on shutdown
+	int32 GetNumDropped() const { return NumDropped.GetValue(); }
+
+	//Write what is left and stop the writer thread
+	void Shutdown();
+
+	static FString GetDirectory();
+
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+	FRubiksTelemetry();
+	~FRubiksTelemetry();
+
+	TCircularQueue<FRubiksTelemetryRecord> Queue;
+	FThreadSafeCounter NumDropped;
+
+	FRunnableThread* Thread;
+	FEvent* WakeEvent;
+	FThreadSafeBool bStopping;
+
+	//Writer thread only
+	TArray<uint8> PendingBytes;
+	TArray<uint8> CompressedBytes;
+	FArchive* File;
+	int64 FileSize;
+	int32 FileNumber;
+	FString SessionName;
+	uint64 StartCycles;
+
+	void Drain();
+	void WriteBlock();
+	void OpenNextFile();
+	void CloseFile();
+	void DeleteOldFiles();
+};
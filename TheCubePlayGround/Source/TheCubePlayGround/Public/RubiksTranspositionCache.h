@@ -0,0 +1,77 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RubiksCubeState.h"
+
+//What the hint search knows about one cube state
+struct THECUBEPLAYGROUND_API FRubiksHintEntry
+{
+	uint64 Hash;
+
+	//Best next move, only meaningful for exact entries that are not solved
+	FRubiksMove BestMove;
+
+	//Exact distance to solved, or a lower bound when bExact is false
+	int32 Distance;
+
+	bool bExact;
+
+	FRubiksHintEntry()
+		: Hash(0), Distance(0), bExact(false)
+	{
+	}
+};
+
+
+//Fixed size hash table from state hash to hint entry, shared by every cube and thread.
+//Slots are guarded by a small set of striped locks. When two states land in the same slot
+//the exact one, then the one with the larger distance, is kept.
+class THECUBEPLAYGROUND_API FRubiksTranspositionCache
+{
+public:
+	explicit FRubiksTranspositionCache(int32 capacityLog2);
+
+	//The cache used by the hints, loaded from disk on first use
+	static FRubiksTranspositionCache& Get();
+
+	bool Find(uint64 hash, FRubiksHintEntry& outEntry) const;
+
+	void Store(const FRubiksHintEntry& entry);
+
+	void Clear();
+
+	//Write every used slot to a file, returns false if the file could not be written
+	bool SaveToFile(const FString& filename) const;
+
+	//Merge the entries of a file written by SaveToFile
+	bool LoadFromFile(const FString& filename);
+
+	//Default location of the shared cache on disk
+	static FString GetDefaultFilename();
+
+	int32 GetNumUsedSlots() const;
+
+private:
+	//Packed to 16 bytes, Hash == 0 marks an empty slot
+	struct FSlot
+	{
+		uint64 Hash;
+		int16 Layer;
+		uint8 Axis;
+		int8 QuarterTurns;
+		uint8 Distance;
+		uint8 bExact;
+		uint16 Padding;
+	};
+
+	enum { NumLocks = 64 };
+
+	TArray<FSlot> Slots;
+	uint64 SlotMask;
+
+	mutable FCriticalSection Locks[NumLocks];
+
+	FCriticalSection& GetLock(uint64 slotIndex) const { return Locks[slotIndex % NumLocks]; }
+};